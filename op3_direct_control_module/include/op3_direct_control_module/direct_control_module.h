@@ -86,7 +86,7 @@ class DirectControlModule : public robotis_framework::MotionModule, public robot
   std::map<std::string, bool> collision_;
 
   bool checkSelfCollision();
-  bool getDiff(OP3KinematicsDynamics *kinematics, int end_index, int base_index, double &diff);
+  bool getDiff(const Eigen::Vector3d *link_position, int end_index, int base_index, double &diff);
 
   double default_moving_time_;
   double default_moving_angle_;
@@ -124,6 +124,10 @@ class DirectControlModule : public robotis_framework::MotionModule, public robot
   std::string last_msg_;
 
   OP3KinematicsDynamics *op3_kinematics_;
+  // goal pose of the arms for the self collision check, indexed by link id
+  double goal_joint_angle_[ALL_JOINT_ID + 1];
+  Eigen::Vector3d goal_link_position_[ALL_JOINT_ID + 1];
+  Eigen::Matrix3d goal_link_orientation_[ALL_JOINT_ID + 1];
 };
 
 }
@@ -49,6 +49,13 @@ DirectControlModule::DirectControlModule()
   control_mode_ = robotis_framework::PositionControl;
 
   last_msg_time_ = ros::Time::now();
+
+  for (int id = 0; id <= ALL_JOINT_ID; id++)
+  {
+    goal_joint_angle_[id] = 0.0;
+    goal_link_position_[id].setZero();
+    goal_link_orientation_[id].setIdentity();
+  }
 }
 
 DirectControlModule::~DirectControlModule()
@@ -193,7 +200,10 @@ void DirectControlModule::setJointCallback(const sensor_msgs::JointState::ConstP
   {
     // check collision of target angle
     will_be_collision_ = false;
-    OP3KinematicsDynamics *op3_kinematics_for_target = new OP3KinematicsDynamics(WholeBody);
+    // the model is shared, the target pose only needs a state of its own
+    const OP3Model &op3_model = op3_kinematics_->getModel();
+    KinematicsState target_state;
+
     // set goal angle and run forward kinematics
     for ( std::map<std::string, int>::iterator joint_index_it = using_joint_name_.begin();
           joint_index_it != using_joint_name_.end(); joint_index_it++)
@@ -202,20 +212,20 @@ void DirectControlModule::setJointCallback(const sensor_msgs::JointState::ConstP
       int index = joint_index_it->second;
       double target_position = target_position_.coeff(0, index);
 
-      LinkData *op3_link = op3_kinematics_for_target->getLinkData(joint_name);
-      if(op3_link != NULL)
-        op3_link->joint_angle_ = target_position;
+      int link_id = op3_model.getLinkId(joint_name);
+      if(link_id != -1)
+        target_state.joint_angle_[link_id] = target_position;
     }
 
-    op3_kinematics_for_target->calcForwardKinematics(0);
+    op3_model.calcForwardKinematics(target_state);
 
     double diff_length = 0.0;
-    bool result = getDiff(op3_kinematics_for_target, RIGHT_END_EFFECTOR_INDEX, BASE_INDEX, diff_length);
+    bool result = getDiff(target_state.position_, RIGHT_END_EFFECTOR_INDEX, BASE_INDEX, diff_length);
     if(result == true && diff_length < 0.075)
       will_be_collision_ = true;
 
     diff_length = 0.0;
-    result = getDiff(op3_kinematics_for_target, LEFT_END_EFFECTOR_INDEX, BASE_INDEX, diff_length);
+    result = getDiff(target_state.position_, LEFT_END_EFFECTOR_INDEX, BASE_INDEX, diff_length);
     if(result == true && diff_length < 0.075)
       will_be_collision_ = true;
   }
@@ -289,6 +299,8 @@ void DirectControlModule::process(std::map<std::string, robotis_framework::Dynam
 
   if(check_collision_ == true)
   {
+    const OP3Model &op3_model = op3_kinematics_->getModel();
+
     // set goal angle and run forward kinematics
     for (std::map<std::string, robotis_framework::DynamixelState *>::iterator state_it = result_.begin();
          state_it != result_.end(); state_it++)
@@ -297,12 +309,14 @@ void DirectControlModule::process(std::map<std::string, robotis_framework::Dynam
       int index = using_joint_name_[joint_name];
       double goal_position = goal_position_.coeff(0, index);
 
-      LinkData *op3_link = op3_kinematics_->getLinkData(joint_name);
-      if(op3_link != NULL)
-        op3_link->joint_angle_ = goal_position;
+      int link_id = op3_model.getLinkId(joint_name);
+      if(link_id != -1)
+        goal_joint_angle_[link_id] = goal_position;
     }
 
-    op3_kinematics_->calcForwardKinematics(0);
+    // only both arms are checked, so the unrolled arm chains are enough
+    calcChainForwardKinematics<ID_R_ARM_END>(goal_joint_angle_, goal_link_position_, goal_link_orientation_);
+    calcChainForwardKinematics<ID_L_ARM_END>(goal_joint_angle_, goal_link_position_, goal_link_orientation_);
 
     // check self collision
     checkSelfCollision();
@@ -457,7 +471,7 @@ bool DirectControlModule::checkSelfCollision()
   // right arm : end-effector
   // get length between right arm and base
   double diff_length = 0.0;
-  bool result = getDiff(op3_kinematics_, RIGHT_END_EFFECTOR_INDEX, BASE_INDEX, diff_length);
+  bool result = getDiff(goal_link_position_, RIGHT_END_EFFECTOR_INDEX, BASE_INDEX, diff_length);
 
   // check collision
   if(result == true && diff_length < collision_boundary)
@@ -474,7 +488,7 @@ bool DirectControlModule::checkSelfCollision()
   // right arm : elbow
   // get length between right elbow and base
   diff_length = 0.0;
-  result = getDiff(op3_kinematics_, RIGHT_ELBOW_INDEX, BASE_INDEX, diff_length);
+  result = getDiff(goal_link_position_, RIGHT_ELBOW_INDEX, BASE_INDEX, diff_length);
 
   // check collision
   if(result == true && diff_length < collision_boundary)
@@ -490,7 +504,7 @@ bool DirectControlModule::checkSelfCollision()
   // left arm : end-effector
   // get left arm end effect position
   diff_length = 0.0;
-  result = getDiff(op3_kinematics_, LEFT_END_EFFECTOR_INDEX, BASE_INDEX, diff_length);
+  result = getDiff(goal_link_position_, LEFT_END_EFFECTOR_INDEX, BASE_INDEX, diff_length);
 
   // check collision
   if(result == true && diff_length < collision_boundary)
@@ -507,7 +521,7 @@ bool DirectControlModule::checkSelfCollision()
   // left arm : elbow
   // get length between left elbow and base
   diff_length = 0.0;
-  result = getDiff(op3_kinematics_, LEFT_ELBOW_INDEX, BASE_INDEX, diff_length);
+  result = getDiff(goal_link_position_, LEFT_ELBOW_INDEX, BASE_INDEX, diff_length);
 
   // check collision
   if(result == true && diff_length < collision_boundary)
@@ -526,13 +540,13 @@ bool DirectControlModule::checkSelfCollision()
   return collision_result;
 }
 
-bool DirectControlModule::getDiff(OP3KinematicsDynamics *kinematics, int end_index, int base_index, double &diff)
+bool DirectControlModule::getDiff(const Eigen::Vector3d *link_position, int end_index, int base_index, double &diff)
 {
-  if(kinematics->op3_link_data_[end_index] == NULL | kinematics->op3_link_data_[base_index] == NULL)
+  if(end_index < 0 || end_index > ALL_JOINT_ID || base_index < 0 || base_index > ALL_JOINT_ID)
     return false;
 
-  Eigen::Vector3d end_position = kinematics->op3_link_data_[end_index]->position_;
-  Eigen::Vector3d base_position = kinematics->op3_link_data_[base_index]->position_;
+  Eigen::Vector3d end_position = link_position[end_index];
+  Eigen::Vector3d base_position = link_position[base_index];
   Eigen::Vector3d diff_vec = base_position - end_position;
   diff_vec.coeffRef(2) = 0;
 
@@ -0,0 +1,79 @@
+/*******************************************************************************
+* Copyright 2017 ROBOTIS CO., LTD.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+/* Author: Kayman */
+
+#ifndef FORWARD_KINEMATICS_BATCH_H_
+#define FORWARD_KINEMATICS_BATCH_H_
+
+#include <cstddef>
+
+#include "op3_kinematics_dynamics_define.h"
+
+namespace robotis_op
+{
+
+// joint angles of many configurations, one array per joint id (structure of arrays).
+// joints left NULL keep their current angle in every configuration
+struct JointAngleArray
+{
+  JointAngleArray()
+  {
+    for (int id = 0; id <= ALL_JOINT_ID; id++)
+      joint_angle[id] = NULL;
+  }
+
+  const double *joint_angle[ALL_JOINT_ID + 1];
+};
+
+// pose of one link in every configuration.
+// orientation is row-major, leave it NULL when only the position is needed
+struct LinkPoseArray
+{
+  LinkPoseArray()
+    : link_id(-1)
+  {
+    for (int ix = 0; ix < 3; ix++)
+      position[ix] = NULL;
+    for (int ix = 0; ix < 9; ix++)
+      orientation[ix] = NULL;
+  }
+
+  int link_id;
+  double *position[3];
+  double *orientation[9];
+};
+
+// the kinematic tree in depth-first order, as compiled by OP3KinematicsDynamics
+struct ForwardKinematicsBatchModel
+{
+  int link_count;
+  int link_id[ALL_JOINT_ID + 1];
+  int parent[ALL_JOINT_ID + 1];  // position of the parent, -1 for the root
+  double relative_position[ALL_JOINT_ID + 1][3];
+  double joint_axis[ALL_JOINT_ID + 1][3];
+  double joint_angle[ALL_JOINT_ID + 1];  // used for joints without an input array
+};
+
+// FK of count configurations, vectorized across configurations (AVX / SSE2 / scalar as in leg_ik_batch.h)
+// and split over thread_count threads. only the links on the way to the requested ones are computed.
+// returns false if a requested link is not in the tree
+bool calcForwardKinematicsBatch(const ForwardKinematicsBatchModel &model, const JointAngleArray &angle,
+                                LinkPoseArray *link_pose, int link_pose_count, int count, int thread_count);
+
+}
+
+#endif /* FORWARD_KINEMATICS_BATCH_H_ */
@@ -0,0 +1,165 @@
+/*******************************************************************************
+* Copyright 2017 ROBOTIS CO., LTD.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+/* Author: Kayman */
+
+#ifndef INVERSE_KINEMATICS_SOLVER_H_
+#define INVERSE_KINEMATICS_SOLVER_H_
+
+#include <eigen3/Eigen/Eigen>
+
+#include "op3_kinematics_dynamics_define.h"
+
+namespace robotis_op
+{
+
+// 6 x route size, the storage is fixed so the solver never allocates
+typedef Eigen::Matrix<double, 6, Eigen::Dynamic, Eigen::ColMajor, 6, ALL_JOINT_ID + 1> IKJacobian;
+typedef Eigen::Matrix<double, Eigen::Dynamic, 1, Eigen::ColMajor, ALL_JOINT_ID + 1, 1> IKJointVector;
+typedef Eigen::Matrix<double, 6, 1> IKError;
+typedef Eigen::Matrix<double, 6, 6> IKSquareMatrix;
+// route size x 6, maps a pose error to a joint step
+typedef Eigen::Matrix<double, Eigen::Dynamic, 6, Eigen::ColMajor, ALL_JOINT_ID + 1, 6> IKGainMatrix;
+
+struct InverseKinematicsOption
+{
+  InverseKinematicsOption()
+    : clamp_joint_limit(false),
+      warm_start(false),
+      adaptive_damping(false)
+  {
+  }
+
+  bool clamp_joint_limit;  // keep route joints inside their limits while iterating, stop when a limit blocks
+  bool warm_start;         // start from the last solution of the same route when it is closer to the target
+  bool adaptive_damping;   // weighted solves use Levenberg-Marquardt damping instead of the fixed one
+};
+
+// one bounded step per call for streaming targets (teleoperation, visual servoing)
+struct DifferentialIKOption
+{
+  DifferentialIKOption()
+    : control_cycle(0.008),
+      max_joint_velocity(4.0),
+      damping(1e-4),
+      gain(1.0),
+      limit_margin(0.1),
+      limit_avoidance_gain(0.5),
+      reuse_threshold(0.01)
+  {
+  }
+
+  double control_cycle;         // time between calls [s]
+  double max_joint_velocity;    // the whole step is scaled down so no joint goes faster [rad/s]
+  double damping;               // added to the diagonal of J J^T
+  double gain;                  // part of the pose error removed per step, 1 for a full step
+  double limit_margin;          // joints closer than this to a limit are pushed back [rad]
+  double limit_avoidance_gain;  // part of the margin violation undone per step, in the null space of the task
+  double reuse_threshold;       // keep the last factorization while no route joint moved more than this [rad],
+                                // 0 disables reuse
+};
+
+struct InverseKinematicsResult
+{
+  InverseKinematicsResult()
+    : converged(false),
+      warm_started(false),
+      limit_blocked(false),
+      jacobian_reused(false),
+      iterations(0),
+      residual(0.0),
+      limit_violations(0)
+  {
+  }
+
+  bool converged;        // residual went below ik_err
+  bool warm_started;     // the solve started from the cached solution
+  bool limit_blocked;    // stopped early, a clamped joint kept the residual from decreasing
+  bool jacobian_reused;  // differential IK only : the step used the cached factorization
+  int iterations;        // joint updates applied
+  double residual;       // norm of the last pose error
+  int limit_violations;  // route joints outside their limits after the solve
+};
+
+// dq = J^T (J J^T)^-1 e
+class PseudoInverseIKPolicy
+{
+ public:
+  void calcJointStep(const IKJacobian &jacobian, const IKError &err, IKJointVector &delta_angle) const
+  {
+    IKSquareMatrix jacobian_trans;
+    jacobian_trans.noalias() = jacobian * jacobian.transpose();
+
+    delta_angle.noalias() = jacobian.transpose() * jacobian_trans.ldlt().solve(err);
+  }
+};
+
+// dq = W J^T (J W J^T + damping)^-1 e, W is diagonal
+class WeightedDampedIKPolicy
+{
+ public:
+  WeightedDampedIKPolicy(const IKJointVector &weight, double p_damping, double R_damping)
+    : weight_(weight)
+  {
+    damping_ << p_damping, p_damping, p_damping, R_damping, R_damping, R_damping;
+  }
+
+  void calcJointStep(const IKJacobian &jacobian, const IKError &err, IKJointVector &delta_angle) const
+  {
+    IKJacobian weighted_jacobian = jacobian * weight_.asDiagonal();
+
+    IKSquareMatrix jacobian_trans;
+    jacobian_trans.noalias() = weighted_jacobian * jacobian.transpose();
+    jacobian_trans.diagonal() += damping_;
+
+    delta_angle.noalias() = weighted_jacobian.transpose() * jacobian_trans.ldlt().solve(err);
+  }
+
+ private:
+  IKJointVector weight_;
+  IKError damping_;
+};
+
+// dq = W J^T (J W J^T + (|e|^2 + bias) I)^-1 e
+// the damping follows the error, large far from the target and small near it
+class LevenbergMarquardtIKPolicy
+{
+ public:
+  LevenbergMarquardtIKPolicy(const IKJointVector &weight, double bias_damping)
+    : weight_(weight),
+      bias_damping_(bias_damping)
+  {
+  }
+
+  void calcJointStep(const IKJacobian &jacobian, const IKError &err, IKJointVector &delta_angle) const
+  {
+    IKJacobian weighted_jacobian = jacobian * weight_.asDiagonal();
+
+    IKSquareMatrix jacobian_trans;
+    jacobian_trans.noalias() = weighted_jacobian * jacobian.transpose();
+    jacobian_trans.diagonal().array() += err.squaredNorm() + bias_damping_;
+
+    delta_angle.noalias() = weighted_jacobian.transpose() * jacobian_trans.ldlt().solve(err);
+  }
+
+ private:
+  IKJointVector weight_;
+  double bias_damping_;
+};
+
+}
+
+#endif /* INVERSE_KINEMATICS_SOLVER_H_ */
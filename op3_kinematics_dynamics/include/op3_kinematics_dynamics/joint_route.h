@@ -0,0 +1,84 @@
+/*******************************************************************************
+* Copyright 2017 ROBOTIS CO., LTD.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+/* Author: Kayman */
+
+#ifndef JOINT_ROUTE_H_
+#define JOINT_ROUTE_H_
+
+#include <vector>
+#include <cstddef>
+
+namespace robotis_op
+{
+
+// non-owning view of a joint route (base side first).
+// the ids are owned by the route table of OP3Model or by the given vector,
+// so a route must not outlive them.
+class JointRoute
+{
+ public:
+  JointRoute()
+    : joint_id_(NULL),
+      size_(0)
+  {
+  }
+
+  JointRoute(const int *joint_id, int size)
+    : joint_id_(joint_id),
+      size_(size)
+  {
+  }
+
+  explicit JointRoute(const std::vector<int> &joint_id)
+    : joint_id_(joint_id.empty() ? NULL : &joint_id[0]),
+      size_(joint_id.size())
+  {
+  }
+
+  int size() const
+  {
+    return size_;
+  }
+
+  bool empty() const
+  {
+    return size_ == 0;
+  }
+
+  int operator[](int index) const
+  {
+    return joint_id_[index];
+  }
+
+  const int *begin() const
+  {
+    return joint_id_;
+  }
+
+  const int *end() const
+  {
+    return joint_id_ + size_;
+  }
+
+ private:
+  const int *joint_id_;
+  int size_;
+};
+
+}
+
+#endif /* JOINT_ROUTE_H_ */
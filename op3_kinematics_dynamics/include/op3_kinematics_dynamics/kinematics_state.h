@@ -0,0 +1,99 @@
+/*******************************************************************************
+* Copyright 2017 ROBOTIS CO., LTD.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+/* Author: Kayman */
+
+#ifndef KINEMATICS_STATE_H_
+#define KINEMATICS_STATE_H_
+
+#include <eigen3/Eigen/Eigen>
+
+#include "op3_kinematics_dynamics_define.h"
+#include "joint_route.h"
+#include "inverse_kinematics_solver.h"
+
+namespace robotis_op
+{
+
+class OP3Model;
+
+// the mutable part of the kinematics : joint angles, link poses and solver caches.
+// it is plain fixed-size storage, so one can be made per thread or per query and used with a shared OP3Model.
+// a state belongs to the model it was first computed with
+class KinematicsState
+{
+ public:
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+  KinematicsState();
+  ~KinematicsState();
+
+  // zero joint angles and rates, poses at the origin, caches cleared
+  void reset();
+
+  // indexed by link id
+  double joint_angle_[ALL_JOINT_ID + 1];
+  double joint_velocity_[ALL_JOINT_ID + 1];
+  double joint_acceleration_[ALL_JOINT_ID + 1];
+  Eigen::Vector3d position_[ALL_JOINT_ID + 1];
+  Eigen::Matrix3d orientation_[ALL_JOINT_ID + 1];
+  // bumped every time the pose of the link is written, so a copy of the poses can be refreshed selectively
+  unsigned int pose_serial_[ALL_JOINT_ID + 1];
+
+  // velocity and acceleration of each link origin in the base frame,
+  // only written by OP3Model::calcForwardKinematicsWithRates
+  Eigen::Vector3d linear_velocity_[ALL_JOINT_ID + 1];
+  Eigen::Vector3d angular_velocity_[ALL_JOINT_ID + 1];
+  Eigen::Vector3d linear_acceleration_[ALL_JOINT_ID + 1];
+  Eigen::Vector3d angular_acceleration_[ALL_JOINT_ID + 1];
+
+  InverseKinematicsOption ik_option_;
+  InverseKinematicsResult ik_result_;  // diagnostics of the last numeric IK with this state
+
+ private:
+  friend class OP3Model;
+
+  // indexed by position in the model's depth-first order
+  double fk_angle_[ALL_JOINT_ID + 1];          // joint angle used by the last FK of each link
+  Eigen::Vector3d branch_mc_[ALL_JOINT_ID + 1];  // first moment of each branch
+  bool branch_mc_valid_;
+
+  // last solution of each end link, used for warm start. the route ids are copied, a route may not outlive its
+  // vector and another route could later get the same address
+  int ik_warm_start_joint_[ALL_JOINT_ID + 1][ALL_JOINT_ID + 1];
+  int ik_warm_start_joint_count_[ALL_JOINT_ID + 1];  // 0 when there is no solution
+  double ik_warm_start_angle_[ALL_JOINT_ID + 1][ALL_JOINT_ID + 1];
+
+  // the jacobian and step matrix of the last few differential IK routes
+  struct DifferentialIKCache
+  {
+    bool valid;
+    int to;
+    int joint_id[ALL_JOINT_ID + 1];  // copy of the route ids
+    int joint_count;
+    double angle[ALL_JOINT_ID + 1];  // route joints when the jacobian was taken
+    IKJacobian jacobian;
+    IKGainMatrix gain;
+  };
+  static const int DIFFERENTIAL_IK_CACHE_SIZE = 4;
+
+  DifferentialIKCache differential_ik_cache_[DIFFERENTIAL_IK_CACHE_SIZE];
+  int differential_ik_cache_next_;
+};
+
+}
+
+#endif /* KINEMATICS_STATE_H_ */
@@ -0,0 +1,66 @@
+/*******************************************************************************
+* Copyright 2017 ROBOTIS CO., LTD.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+/* Author: Kayman */
+
+#ifndef LEG_IK_BATCH_H_
+#define LEG_IK_BATCH_H_
+
+#include "op3_kinematics_dynamics_define.h"
+
+namespace robotis_op
+{
+
+// foot poses relative to the hip, one array per component (structure of arrays)
+struct LegPoseArray
+{
+  const double *x;
+  const double *y;
+  const double *z;
+  const double *roll;
+  const double *pitch;
+  const double *yaw;
+};
+
+// joint[0] ~ joint[5] : hip yaw, hip roll, hip pitch, knee, ankle pitch, ankle roll
+// valid[i] is 1 when pose i is reachable and inside the joint limits, 0 otherwise
+struct LegJointArray
+{
+  double *joint[MAX_LEG_ID];
+  unsigned char *valid;
+};
+
+struct LegIKParameter
+{
+  double thigh_length_m;
+  double calf_length_m;
+  double ankle_length_m;
+  double hip_pitch_offset_m;
+  double hip_offset_angle_rad;
+
+  double joint_direction[MAX_LEG_ID];
+  double joint_limit_min[MAX_LEG_ID];
+  double joint_limit_max[MAX_LEG_ID];
+};
+
+// closed-form leg IK over many poses, vectorized across poses with AVX or SSE2 when the compiler
+// targets them (e.g. -mavx2) and scalar otherwise. returns the number of valid poses
+int calcLegInverseKinematicsBatch(const LegIKParameter &param, const LegPoseArray &pose, LegJointArray &out,
+                                  int count);
+
+}
+
+#endif /* LEG_IK_BATCH_H_ */
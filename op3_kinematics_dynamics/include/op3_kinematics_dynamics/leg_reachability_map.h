@@ -0,0 +1,125 @@
+/*******************************************************************************
+* Copyright 2017 ROBOTIS CO., LTD.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+/* Author: Kayman */
+
+#ifndef LEG_REACHABILITY_MAP_H_
+#define LEG_REACHABILITY_MAP_H_
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "op3_kinematics_dynamics_define.h"
+
+namespace robotis_op
+{
+
+class OP3Model;
+
+#define LEG_REACHABILITY_MAP_MAX_YAW_SAMPLE (8)
+
+// the grid is over the foot position relative to the hip, in the frame of the closed-form leg IK
+// (calcInverseKinematicsForRightLeg / LeftLeg), with the sole level (roll = pitch = 0)
+struct LegReachabilityMapOption
+{
+  LegReachabilityMapOption()
+    : voxel_size(0.005),
+      yaw_sample_count(7),
+      yaw_max(0.45)
+  {
+    min[0] = -0.15;
+    min[1] = -0.12;
+    min[2] = -0.26;
+    max[0] = 0.15;
+    max[1] = 0.12;
+    max[2] = -0.08;
+  }
+
+  double min[3];
+  double max[3];
+  double voxel_size;
+  int yaw_sample_count;  // foot yaw samples over [-yaw_max, yaw_max], up to LEG_REACHABILITY_MAP_MAX_YAW_SAMPLE
+  double yaw_max;
+};
+
+// file layout, native byte order : header, then right leg cells, then left leg cells.
+// cells are ordered x fastest, then y, then z
+struct LegReachabilityMapHeader
+{
+  uint32_t magic;
+  uint32_t version;
+  uint32_t size[3];
+  uint32_t yaw_sample_count;
+  double origin[3];  // corner of the first voxel
+  double voxel_size;
+  double yaw_max;
+  double max_manipulability;
+};
+
+struct LegReachabilityCell
+{
+  uint8_t yaw_mask;        // bit k is set when yaw sample k is reachable inside the joint limits
+  uint8_t manipulability;  // sqrt(det(J J^T)) of the leg at the sample nearest to zero yaw, 255 = max of the map
+};
+
+// precomputed leg reachability, sampled at the voxel centers.
+// a map is built once (offline, see leg_reachability_map_generator) and then loaded with mmap,
+// after which a query is an index computation and one memory read
+class LegReachabilityMap
+{
+ public:
+  LegReachabilityMap();
+  ~LegReachabilityMap();
+
+  bool build(const OP3Model &model, const LegReachabilityMapOption &option);
+  bool save(const std::string &path) const;
+  // maps the file read-only, false if it is missing or is not a map of this version
+  bool load(const std::string &path);
+  void unload();
+  bool isLoaded() const;
+
+  const LegReachabilityMapHeader &getHeader() const;
+
+  // leg_start_id is ID_R_LEG_START or ID_L_LEG_START. positions outside the grid are unreachable
+  bool isReachable(int leg_start_id, double x, double y, double z) const;            // any sampled yaw
+  bool isReachable(int leg_start_id, double x, double y, double z, double yaw) const;  // the nearest yaw sample
+  // 0 ~ 1, relative to the most dexterous voxel of the map. 0 when unreachable
+  double getManipulability(int leg_start_id, double x, double y, double z) const;
+
+  static const uint32_t MAGIC = 0x4d4c524f;  // "ORLM"
+  static const uint32_t VERSION = 1;
+
+ private:
+  // owns the mapping, not copyable
+  LegReachabilityMap(const LegReachabilityMap &);
+  LegReachabilityMap &operator=(const LegReachabilityMap &);
+
+  const LegReachabilityCell *findCell(int leg_start_id, double x, double y, double z) const;
+
+  LegReachabilityMapHeader header_;
+  double inverse_voxel_size_;
+  const LegReachabilityCell *cell_;  // both legs, into cell_buffer_ or the mapped file
+  int cell_count_;                   // per leg
+
+  std::vector<LegReachabilityCell> cell_buffer_;
+  void *mapped_data_;
+  size_t mapped_size_;
+};
+
+}
+
+#endif /* LEG_REACHABILITY_MAP_H_ */
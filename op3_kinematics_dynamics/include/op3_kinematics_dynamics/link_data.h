@@ -29,6 +29,8 @@ namespace robotis_op
 class LinkData
 {
  public:
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
   LinkData();
   ~LinkData();
 
@@ -40,10 +42,10 @@ class LinkData
 
   double mass_;
 
-  Eigen::MatrixXd relative_position_;
-  Eigen::MatrixXd joint_axis_;
-  Eigen::MatrixXd center_of_mass_;
-  Eigen::MatrixXd inertia_;
+  Eigen::Vector3d relative_position_;
+  Eigen::Vector3d joint_axis_;
+  Eigen::Vector3d center_of_mass_;
+  Eigen::Matrix3d inertia_;
 
   double joint_limit_max_;
   double joint_limit_min_;
@@ -52,9 +54,14 @@ class LinkData
   double joint_velocity_;
   double joint_acceleration_;
 
-  Eigen::MatrixXd position_;
-  Eigen::MatrixXd orientation_;
-  Eigen::MatrixXd transformation_;
+  Eigen::Vector3d position_;
+  Eigen::Matrix3d orientation_;
+  Eigen::Isometry3d transformation_;
+
+  // dynamic-size copies for callers that still work with Eigen::MatrixXd
+  Eigen::MatrixXd getPosition() const;
+  Eigen::MatrixXd getOrientation() const;
+  Eigen::MatrixXd getTransformation() const;
 };
 
 }
@@ -0,0 +1,192 @@
+/*******************************************************************************
+* Copyright 2017 ROBOTIS CO., LTD.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+/* Author: Kayman */
+
+#ifndef OP3_CHAIN_KINEMATICS_H_
+#define OP3_CHAIN_KINEMATICS_H_
+
+#include <cmath>
+#include <eigen3/Eigen/Eigen>
+
+#include "op3_kinematics_dynamics_define.h"
+#include "op3_link_table.h"
+#include "inverse_kinematics_solver.h"
+
+namespace robotis_op
+{
+
+// parent * R(axis, angle) for a joint axis known at compile time.
+// only zero and signed unit axes are defined, any other axis fails to compile
+template<int X, int Y, int Z>
+struct JointRotation;
+
+template<>
+struct JointRotation<0, 0, 0>
+{
+  static void apply(const Eigen::Matrix3d &parent, double, Eigen::Matrix3d &orientation)
+  {
+    orientation = parent;
+  }
+
+  static void getAxis(const Eigen::Matrix3d &, Eigen::Vector3d &axis)
+  {
+    axis.setZero();
+  }
+};
+
+template<int S>
+struct JointRotation<S, 0, 0>
+{
+  static void apply(const Eigen::Matrix3d &parent, double angle, Eigen::Matrix3d &orientation)
+  {
+    double s = S * std::sin(angle), c = std::cos(angle);
+
+    orientation.col(0) = parent.col(0);
+    orientation.col(1) = c * parent.col(1) + s * parent.col(2);
+    orientation.col(2) = c * parent.col(2) - s * parent.col(1);
+  }
+
+  static void getAxis(const Eigen::Matrix3d &orientation, Eigen::Vector3d &axis)
+  {
+    axis = S * orientation.col(0);
+  }
+};
+
+template<int S>
+struct JointRotation<0, S, 0>
+{
+  static void apply(const Eigen::Matrix3d &parent, double angle, Eigen::Matrix3d &orientation)
+  {
+    double s = S * std::sin(angle), c = std::cos(angle);
+
+    orientation.col(0) = c * parent.col(0) - s * parent.col(2);
+    orientation.col(1) = parent.col(1);
+    orientation.col(2) = c * parent.col(2) + s * parent.col(0);
+  }
+
+  static void getAxis(const Eigen::Matrix3d &orientation, Eigen::Vector3d &axis)
+  {
+    axis = S * orientation.col(1);
+  }
+};
+
+template<int S>
+struct JointRotation<0, 0, S>
+{
+  static void apply(const Eigen::Matrix3d &parent, double angle, Eigen::Matrix3d &orientation)
+  {
+    double s = S * std::sin(angle), c = std::cos(angle);
+
+    orientation.col(0) = c * parent.col(0) + s * parent.col(1);
+    orientation.col(1) = c * parent.col(1) - s * parent.col(0);
+    orientation.col(2) = parent.col(2);
+  }
+
+  static void getAxis(const Eigen::Matrix3d &orientation, Eigen::Vector3d &axis)
+  {
+    axis = S * orientation.col(2);
+  }
+};
+
+// FK and jacobian unrolled over the route from the base to ID, built from OP3LinkTrait.
+// the offsets and axes are compile-time constants, so each chain compiles to straight-line code
+template<int ID, int PARENT = OP3LinkTrait<ID>::PARENT>
+struct OP3ChainKinematics
+{
+  typedef OP3LinkTrait<ID> Link;
+  typedef JointRotation<Link::AXIS_X, Link::AXIS_Y, Link::AXIS_Z> Rotation;
+
+  enum
+  {
+    DEPTH = OP3ChainKinematics<PARENT>::DEPTH + 1
+  };
+
+  static void calcForwardKinematics(const double *joint_angle, Eigen::Vector3d *position,
+                                    Eigen::Matrix3d *orientation)
+  {
+    OP3ChainKinematics<PARENT>::calcForwardKinematics(joint_angle, position, orientation);
+
+    position[ID].noalias() = orientation[PARENT] * Link::getRelativePosition();
+    position[ID] += position[PARENT];
+    Rotation::apply(orientation[PARENT], joint_angle[ID], orientation[ID]);
+  }
+
+  static void calcJacobian(const Eigen::Vector3d *position, const Eigen::Matrix3d *orientation,
+                           const Eigen::Vector3d &tar_position, IKJacobian &jacobian)
+  {
+    OP3ChainKinematics<PARENT>::calcJacobian(position, orientation, tar_position, jacobian);
+
+    Eigen::Vector3d axis;
+    Rotation::getAxis(orientation[ID], axis);
+
+    jacobian.block<3, 1>(0, DEPTH - 1) = axis.cross(tar_position - position[ID]);
+    jacobian.block<3, 1>(3, DEPTH - 1) = axis;
+  }
+};
+
+// the root of the tree sits at the origin
+template<int ID>
+struct OP3ChainKinematics<ID, -1>
+{
+  typedef OP3LinkTrait<ID> Link;
+  typedef JointRotation<Link::AXIS_X, Link::AXIS_Y, Link::AXIS_Z> Rotation;
+
+  enum
+  {
+    DEPTH = 1
+  };
+
+  static void calcForwardKinematics(const double *joint_angle, Eigen::Vector3d *position,
+                                    Eigen::Matrix3d *orientation)
+  {
+    position[ID].setZero();
+    Rotation::apply(Eigen::Matrix3d::Identity(), joint_angle[ID], orientation[ID]);
+  }
+
+  static void calcJacobian(const Eigen::Vector3d *position, const Eigen::Matrix3d *orientation,
+                           const Eigen::Vector3d &tar_position, IKJacobian &jacobian)
+  {
+    Eigen::Vector3d axis;
+    Rotation::getAxis(orientation[ID], axis);
+
+    jacobian.block<3, 1>(0, 0) = axis.cross(tar_position - position[ID]);
+    jacobian.block<3, 1>(3, 0) = axis;
+  }
+};
+
+// FK of the links from the base to END_ID, e.g. calcChainForwardKinematics<ID_R_LEG_END>.
+// the arrays are indexed by link id and only the entries of the chain are written
+template<int END_ID>
+inline void calcChainForwardKinematics(const double *joint_angle, Eigen::Vector3d *position,
+                                       Eigen::Matrix3d *orientation)
+{
+  OP3ChainKinematics<END_ID>::calcForwardKinematics(joint_angle, position, orientation);
+}
+
+// jacobian of END_ID from poses computed by calcChainForwardKinematics<END_ID>,
+// the columns follow OP3Model::getRoute(END_ID)
+template<int END_ID>
+inline void calcChainJacobian(const Eigen::Vector3d *position, const Eigen::Matrix3d *orientation,
+                              IKJacobian &jacobian)
+{
+  jacobian.resize(6, OP3ChainKinematics<END_ID>::DEPTH);
+  OP3ChainKinematics<END_ID>::calcJacobian(position, orientation, position[END_ID], jacobian);
+}
+
+}
+
+#endif /* OP3_CHAIN_KINEMATICS_H_ */
@@ -24,6 +24,15 @@
 
 #include "op3_kinematics_dynamics_define.h"
 #include "link_data.h"
+#include "joint_route.h"
+#include "inverse_kinematics_solver.h"
+#include "leg_ik_batch.h"
+#include "forward_kinematics_batch.h"
+#include "kinematics_state.h"
+#include "op3_model.h"
+#include "op3_link_table.h"
+#include "op3_chain_kinematics.h"
+#include "leg_reachability_map.h"
 
 namespace robotis_op
 {
@@ -35,25 +44,61 @@ enum TreeSelect
   WholeBody
 };
 
+// the link data interface over an OP3Model and one KinematicsState.
+// joint angles are read from op3_link_data_ and the results are written back to it on every call,
+// so it is meant for one thread. use getModel() with a KinematicsState of your own elsewhere
 class OP3KinematicsDynamics
 {
 
  public:
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
   OP3KinematicsDynamics();
   ~OP3KinematicsDynamics();
   OP3KinematicsDynamics(TreeSelect tree);
 
+  const OP3Model &getModel() const;
+  KinematicsState &getKinematicsState();
+
   std::vector<int> findRoute(int to);
   std::vector<int> findRoute(int from, int to);
+  // precomputed routes, valid as long as the model lives
+  JointRoute getRoute(int to) const;
+  JointRoute getRoute(int from, int to) const;
 
   double calcTotalMass(int joint_id);
   Eigen::MatrixXd calcMC(int joint_id);
   Eigen::MatrixXd calcCOM(Eigen::MatrixXd mc);
 
   void calcForwardKinematics(int joint_ID);
+  // recomputes only the links whose joint angle, or an ancestor's, changed since the last FK
+  void updateKinematics();
+  // FK of count configurations at once, op3_link_data_ is left untouched (see forward_kinematics_batch.h)
+  bool calcForwardKinematics(const JointAngleArray &angle, LinkPoseArray *link_pose, int link_pose_count,
+                             int count, int thread_count = 1);
+  // whole-body FK with the joint_velocity_ and joint_acceleration_ of op3_link_data_.
+  // the COM rates and the ZMP below are taken from the last call
+  void calcForwardKinematicsWithRates();
+  Eigen::Vector3d calcCOMVelocity();
+  Eigen::Vector3d calcCOMAcceleration();
+  bool calcZMP(double ground_height, Eigen::Vector3d &zmp);
+  // support polygon and stability margins from the poses of the last FK (see OP3Model)
+  void calcSupportPolygon(SupportPhase phase, double foot_size_x, double foot_size_y, SupportPolygon &polygon);
+  double calcCOMMargin(const SupportPolygon &polygon);
+  bool calcZMPMargin(const SupportPolygon &polygon, double ground_height, double &margin);
+
+  // joint torques for the joint_angle_, joint_velocity_ and joint_acceleration_ of op3_link_data_,
+  // indexed by link id (ALL_JOINT_ID + 1 entries). the gravity-only version ignores the rates
+  void calcInverseDynamics(double *torque);
+  void calcGravityTorque(double *torque);
+  // for the joint angles of op3_link_data_, indexed by link id
+  void calcMassMatrix(JointSpaceMatrix &mass_matrix);
+  void calcCentroidalMomentumMatrix(CentroidalMomentumMatrix &momentum_matrix);
 
   Eigen::MatrixXd calcJacobian(std::vector<int> idx);
+  Eigen::MatrixXd calcJacobian(const JointRoute &idx);
   Eigen::MatrixXd calcJacobianCOM(std::vector<int> idx);
+  Eigen::MatrixXd calcJacobianCOM(const JointRoute &idx);
   Eigen::MatrixXd calcVWerr(Eigen::MatrixXd tar_position, Eigen::MatrixXd curr_position,
                             Eigen::MatrixXd tar_orientation, Eigen::MatrixXd curr_orientation);
 
@@ -68,11 +113,39 @@ class OP3KinematicsDynamics
   bool calcInverseKinematics(int from, int to, Eigen::MatrixXd tar_position, Eigen::MatrixXd tar_orientation,
                              int max_iter, double ik_err, Eigen::MatrixXd weight);
 
+  // numeric IK over a route, every overload above goes through it.
+  // instantiated for PseudoInverseIKPolicy, WeightedDampedIKPolicy and LevenbergMarquardtIKPolicy
+  template<typename IKPolicy>
+  bool solveInverseKinematics(const JointRoute &idx, int to, const Eigen::Vector3d &tar_position,
+                              const Eigen::Matrix3d &tar_orientation, int max_iter, double ik_err,
+                              const IKPolicy &policy);
+  // one bounded step towards a streamed target (see OP3Model)
+  bool calcDifferentialInverseKinematics(const JointRoute &idx, int to, const Eigen::Vector3d &tar_position,
+                                         const Eigen::Matrix3d &tar_orientation, double ik_err,
+                                         const DifferentialIKOption &option);
+  // prioritized whole-body IK from the joint angles of op3_link_data_ (see OP3Model)
+  bool calcWholeBodyInverseKinematics(const WholeBodyIKProblem &problem, int max_iter, double ik_err);
+  // diagnostics of the last numeric IK call
+  const InverseKinematicsResult &getInverseKinematicsResult() const;
+  void setInverseKinematicsOption(const InverseKinematicsOption &option);
+  const InverseKinematicsOption &getInverseKinematicsOption() const;
+
   bool calcInverseKinematicsForLeg(double *out, double x, double y, double z, double roll, double pitch, double yaw);
   bool calcInverseKinematicsForRightLeg(double *out, double x, double y, double z, double roll, double pitch,
                                         double yaw);
   bool calcInverseKinematicsForLeftLeg(double *out, double x, double y, double z, double roll, double pitch,
                                        double yaw);
+  // batch versions over count poses, return the number of valid poses (see leg_ik_batch.h)
+  int calcInverseKinematicsForRightLeg(const LegPoseArray &pose, LegJointArray &out, int count);
+  int calcInverseKinematicsForLeftLeg(const LegPoseArray &pose, LegJointArray &out, int count);
+  LegIKParameter getLegIKParameter(int leg_start_id);
+
+  // closed-form arm IK of the arm end position in the pelvis frame (see OP3Model), out holds
+  // shoulder pitch, shoulder roll and elbow. the single-answer versions pick the branch nearest to
+  // the joint angles of op3_link_data_
+  int calcInverseKinematicsForArm(int arm_start_id, double x, double y, double z, ArmIKSolution &solution);
+  bool calcInverseKinematicsForRightArm(double *out, double x, double y, double z);
+  bool calcInverseKinematicsForLeftArm(double *out, double x, double y, double z);
 
   LinkData *op3_link_data_[ ALL_JOINT_ID + 1];
 
@@ -82,6 +155,8 @@ class OP3KinematicsDynamics
   double getJointDirection(const std::string link_name);
   double getJointDirection(const int link_id);
 
+  // preview gains of the LIPM preview controller for a 1x4 K and a 4x4 P, an empty matrix for other sizes.
+  // the last few results are kept, so asking again for the same parameters costs a copy
   Eigen::MatrixXd calcPreviewParam(double preview_time, double control_cycle,
                                    double lipm_height,
                                    Eigen::MatrixXd K, Eigen::MatrixXd P);
@@ -92,6 +167,35 @@ class OP3KinematicsDynamics
   double calf_length_m_;
   double ankle_length_m_;
   double leg_side_offset_m_;
+
+ private:
+  // copy the joint angles and rates of op3_link_data_ into the state, and the state back after solving
+  void pullJointState();
+  void pushKinematics();
+  bool calcRouteInverseKinematics(const JointRoute &idx, int to, const Eigen::Vector3d &tar_position,
+                                  const Eigen::Matrix3d &tar_orientation, int max_iter, double ik_err,
+                                  const Eigen::MatrixXd *weight);
+
+  struct PreviewParamCache
+  {
+    bool valid;
+    double preview_time;
+    double control_cycle;
+    double lipm_height;
+    double K[4];
+    double P[16];  // column-major
+    Eigen::MatrixXd f;
+  };
+  static const int PREVIEW_PARAM_CACHE_SIZE = 4;
+
+  void resetPreviewParamCache();
+
+  OP3Model model_;
+  KinematicsState state_;
+  unsigned int pushed_pose_serial_[ALL_JOINT_ID + 1];  // pose_serial_ of state_ last copied to op3_link_data_
+
+  PreviewParamCache preview_param_cache_[PREVIEW_PARAM_CACHE_SIZE];
+  int preview_param_cache_next_;  // entry replaced next
 };
 
 }
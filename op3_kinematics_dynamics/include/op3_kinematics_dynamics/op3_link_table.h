@@ -0,0 +1,263 @@
+/*******************************************************************************
+* Copyright 2017 ROBOTIS CO., LTD.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+/* Authors: SCH, Kayman */
+
+#ifndef OP3_LINK_TABLE_H_
+#define OP3_LINK_TABLE_H_
+
+#include <cmath>
+#include <eigen3/Eigen/Eigen>
+
+#include "op3_kinematics_dynamics_define.h"
+
+namespace robotis_op
+{
+
+// the whole body of the OP3, one row per link :
+// LINK(id, name, parent, sibling, child, mass,
+//      relative position x, y, z, joint axis x, y, z,
+//      center of mass x, y, z,
+//      inertia xx, xy, xz, yy, yz, zz,
+//      joint limit max, joint limit min)
+// the same rows expand into the runtime table below and into the compile-time OP3LinkTrait
+#define OP3_WHOLE_BODY_LINK_TABLE(LINK) \
+  LINK(0, "base", -1, -1, 23, 0.0, \
+       0.0, 0.0, 0.0, 0.0, 0.0, 0.0, \
+       0.0, 0.0, 0.0, \
+       0.0, 0.0, 0.0, 0.0, 0.0, 0.0, \
+       100.0, -100.0) \
+  /* ----- passive joint ----- */ \
+  LINK(23, "passive_x", 0, -1, 24, 0.0, \
+       0.0, 0.0, 0.0, 0.0, 0.0, 0.0, \
+       0.0, 0.0, 0.0, \
+       0.0, 0.0, 0.0, 0.0, 0.0, 0.0, \
+       100.0, -100.0) \
+  LINK(24, "passive_y", 23, -1, 25, 0.0, \
+       0.0, 0.0, 0.0, 0.0, 0.0, 0.0, \
+       0.0, 0.0, 0.0, \
+       0.0, 0.0, 0.0, 0.0, 0.0, 0.0, \
+       100.0, -100.0) \
+  LINK(25, "passive_z", 24, -1, 26, 0.0, \
+       0.0, 0.0, 0.385, 0.0, 0.0, 0.0, \
+       0.0, 0.0, 0.0, \
+       0.0, 0.0, 0.0, 0.0, 0.0, 0.0, \
+       100.0, -100.0) \
+  LINK(26, "passive_yaw", 25, -1, 27, 0.0, \
+       0.0, 0.0, 0.0, 0.0, 0.0, 1.0, \
+       0.0, 0.0, 0.0, \
+       0.0, 0.0, 0.0, 0.0, 0.0, 0.0, \
+       100.0, -100.0) \
+  LINK(27, "passive_pitch", 26, -1, 28, 0.0, \
+       0.0, 0.0, 0.0, 0.0, 1.0, 0.0, \
+       0.0, 0.0, 0.0, \
+       0.0, 0.0, 0.0, 0.0, 0.0, 0.0, \
+       100.0, -100.0) \
+  LINK(28, "passive_roll", 27, -1, 29, 0.0, \
+       0.0, 0.0, 0.0, 1.0, 0.0, 0.0, \
+       0.0, 0.0, 0.0, \
+       0.0, 0.0, 0.0, 0.0, 0.0, 0.0, \
+       100.0, -100.0) \
+  /* ----- body ----- */ \
+  LINK(29, "pelvis", 28, -1, 19, 1.3492787, \
+       0.0, 0.0, 0.0, 0.0, 0.0, 0.0, \
+       -0.015014868, 0.00013099, 0.065815797, \
+       0.03603, 0.00000, 0.00016, 0.02210, 0.00000, 0.03830, \
+       100.0, -100.0) \
+  /* ----- head ----- */ \
+  LINK(19, "head_pan", 29, 1, 20, 0.011759436, \
+       -0.001, 0.0, 0.1365, 0.0, 0.0, 1.0, \
+       0.002327479, 0, 0.008227847, \
+       0.00011, 0.00000, 0.00000, 0.00003, 0.00000, 0.00012, \
+       0.5 * M_PI, -0.5 * M_PI) \
+  LINK(20, "head_tilt", 19, -1, -1, 0.13630649, \
+       0.01, 0.019, 0.0285, 0.0, -1.0, 0.0, \
+       0.002298411, -0.018634079, 0.027696734, \
+       0.00113, 0.00001, -0.00005, 0.00114, 0.00002, 0.00084, \
+       0.5 * M_PI, -0.5 * M_PI) \
+  /* ----- right arm ----- */ \
+  LINK(1, "r_sho_pitch", 29, 2, 3, 0.011759436, \
+       -0.001, -0.06, 0.111, 0.0, -1.0, 0.0, \
+       0, -0.008227847, -0.002327479, \
+       0.00018, 0.0, 0.0, 0.00058, -0.00004, 0.00057, \
+       0.5 * M_PI, -0.5 * M_PI) \
+  LINK(3, "r_sho_roll", 1, -1, 5, 0.1775763, \
+       0.019, -0.0285, -0.01, -1.0, 0.0, 0.0, \
+       -0.018438243, -0.045143767, 0.000281212, \
+       0.00043, 0.00000, 0.00000, 0.00112, 0.00000, 0.00113, \
+       0.3 * M_PI, -0.5 * M_PI) \
+  LINK(5, "r_el", 3, -1, 21, 0.041267974, \
+       0, -0.0904, -0.0001, 1.0, 0.0, 0.0, \
+       -0.019000003, -0.070330391, 0.00380012, \
+       0.00277, 0.00002, -0.00001, 0.00090, 0.00004, 0.00255, \
+       0.5 * M_PI, -0.5 * M_PI) \
+  LINK(21, "r_arm_end", 5, -1, -1, 0.0, \
+       0.0, -0.15, 0.0, 0.0, 0.0, 0.0, \
+       0.0, 0.0, 0.0, \
+       0.0, 0.0, 0.0, 0.0, 0.0, 0.0, \
+       100.0, -100.0) \
+  /* ----- left arm ----- */ \
+  LINK(2, "l_sho_pitch", 29, 7, 4, 0.011759436, \
+       -0.001, 0.06, 0.111, 0.0, 1.0, 0.0, \
+       0, 0.008227847, -0.002327479, \
+       0.00018, 0.00000, 0.00000, 0.00058, 0.00004, 0.00057, \
+       0.5 * M_PI, -0.5 * M_PI) \
+  LINK(4, "l_sho_roll", 2, -1, 6, 0.1775763, \
+       0.019, 0.0285, -0.01, -1.0, 0.0, 0.0, \
+       -0.018438243, 0.045143767, 0.000281212, \
+       0.00043, 0.00000, 0.00000, 0.00112, 0.00000, 0.00113, \
+       0.5 * M_PI, -0.3 * M_PI) \
+  LINK(6, "l_el", 4, -1, 22, 0.041267974, \
+       0, 0.0904, -0.0001, 1.0, 0.0, 0.0, \
+       -0.018999997, 0.070330391, 0.003800117, \
+       0.00277, -0.00002, -0.00001, 0.00090, -0.00004, 0.00255, \
+       0.5 * M_PI, -0.5 * M_PI) \
+  LINK(22, "l_arm_end", 6, -1, -1, 0.0, \
+       0.0, 0.15, 0.0, 0.0, 0.0, 0.0, \
+       0.0, 0.0, 0.0, \
+       0.0, 0.0, 0.0, 0.0, 0.0, 0.0, \
+       100.0, -100.0) \
+  /* ----- right leg ----- */ \
+  LINK(7, "r_hip_yaw", 29, 8, 9, 0.011813898, \
+       0, -0.035, 0, 0.0, 0.0, -1.0, \
+       -0.001566062, 0, -0.00774017, \
+       0.00024, 0.00000, 0.00000, 0.00101, 0.00000, 0.00092, \
+       0.45 * M_PI, -0.45 * M_PI) \
+  LINK(9, "r_hip_roll", 7, -1, 11, 0.17885985, \
+       -0.024, 0, -0.0285, -1.0, 0.0, 0.0, \
+       0.00388263, -0.000278863, -0.012138713, \
+       0.00056, 0.00000, 0.00000, 0.00168, 0.00000, 0.00171, \
+       0.3 * M_PI, -0.3 * M_PI) \
+  LINK(11, "r_hip_pitch", 9, -1, 13, 0.11543381, \
+       0.0241, -0.019, 0, 0.0, -1.0, 0.0, \
+       0.000590366, 0.019005093, -0.084075186, \
+       0.04329, -0.00027, 0.00286, 0.04042, 0.00203, 0.00560, \
+       0.4 * M_PI, -0.4 * M_PI) \
+  LINK(13, "r_knee", 11, -1, 15, 0.040146918, \
+       0.0001, 0, -0.11015, 0.0, -1.0, 0.0, \
+       0, 0.021514031, -0.055, \
+       0.01971, -0.00031, -0.00294, 0.01687, -0.00140, 0.00574, \
+       0.1 * M_PI, -0.7 * M_PI) \
+  LINK(15, "r_ank_pitch", 13, -1, 17, 0.17885985, \
+       0, 0, -0.11, 0.0, 1.0, 0.0, \
+       -0.02021737, 0.018721137, 0.012138713, \
+       0.00056, 0.00000, 0.00000, 0.00168, 0.00000, 0.00171, \
+       0.45 * M_PI, -0.45 * M_PI) \
+  LINK(17, "r_ank_roll", 15, -1, 31, 0.069344849, \
+       -0.0241, 0.019, 0, 1.0, 0.0, 0.0, \
+       0.023733194, -0.010370444, -0.027601507, \
+       0.00022, 0.00000, -0.00001, 0.00099, 0.00000, 0.00091, \
+       0.45 * M_PI, -0.45 * M_PI) \
+  LINK(31, "r_leg_end", 17, -1, -1, 0.0, \
+       0.024, 0.0, -0.0305, 0.0, 0.0, 0.0, \
+       0.0, 0.0, 0.0, \
+       0.0, 0.0, 0.0, 0.0, 0.0, 0.0, \
+       100.0, -100.0) \
+  /* ----- left leg ----- */ \
+  LINK(8, "l_hip_yaw", 29, -1, 10, 0.011813898, \
+       0, 0.035, 0, 0.0, 0.0, -1.0, \
+       -0.001566062, 0, -0.00774017, \
+       0.00024, 0.00000, 0.00000, 0.00101, 0.00000, 0.00092, \
+       0.45 * M_PI, -0.45 * M_PI) \
+  LINK(10, "l_hip_roll", 8, -1, 12, 0.17885985, \
+       -0.024, 0, -0.0285, -1.0, 0.0, 0.0, \
+       0.00388263, 0.000278863, -0.012138713, \
+       0.00056, 0.00000, 0.00000, 0.00168, 0.00000, 0.00171, \
+       0.3 * M_PI, -0.3 * M_PI) \
+  LINK(12, "l_hip_pitch", 10, -1, 14, 0.11543381, \
+       0.0241, 0.019, 0, 0.0, 1.0, 0.0, \
+       0.000590367, -0.019005093, -0.084075186, \
+       0.04328, 0.00028, 0.00288, 0.04042, -0.00202, 0.00560, \
+       0.4 * M_PI, -0.4 * M_PI) \
+  LINK(14, "l_knee", 12, -1, 16, 0.040146918, \
+       0.0001, 0, -0.11015, 0.0, 1.0, 0.0, \
+       0, -0.021514031, -0.055, \
+       0.01971, 0.00031, -0.00294, 0.01687, 0.00140, 0.00574, \
+       0.7 * M_PI, -0.1 * M_PI) \
+  LINK(16, "l_ank_pitch", 14, -1, 18, 0.17885985, \
+       0.000, 0.000, -0.110, 0.0, -1.0, 0.0, \
+       -0.02021825, -0.018721131, 0.012138988, \
+       0.00056, 0.00000, 0.00000, 0.00168, 0.00000, 0.00171, \
+       0.45 * M_PI, -0.45 * M_PI) \
+  LINK(18, "l_ank_roll", 16, -1, 30, 0.069344849, \
+       -0.0241, -0.019, 0, 1.0, 0.0, 0.0, \
+       0.023733194, 0.010370444, -0.027601507, \
+       0.00022, 0.00000, -0.00001, 0.00099, 0.00000, 0.00091, \
+       0.45 * M_PI, -0.45 * M_PI) \
+  LINK(30, "l_leg_end", 18, -1, -1, 0.0, \
+       0.024, 0.0, -0.0305, 0.0, 0.0, 0.0, \
+       0.0, 0.0, 0.0, \
+       0.0, 0.0, 0.0, 0.0, 0.0, 0.0, \
+       100.0, -100.0)
+
+struct LinkTableEntry
+{
+  int id;
+  const char *name;
+  int parent;
+  int sibling;
+  int child;
+  double mass;
+  double relative_position[3];
+  double joint_axis[3];
+  double center_of_mass[3];
+  double inertia[6];  // xx, xy, xz, yy, yz, zz
+  double joint_limit_max;
+  double joint_limit_min;
+};
+
+#define OP3_LINK_TABLE_ENTRY(id, name, parent, sibling, child, mass, px, py, pz, ax, ay, az, cx, cy, cz, \
+                             ixx, ixy, ixz, iyy, iyz, izz, limit_max, limit_min) \
+  { id, name, parent, sibling, child, mass, { px, py, pz }, { ax, ay, az }, { cx, cy, cz }, \
+    { ixx, ixy, ixz, iyy, iyz, izz }, limit_max, limit_min },
+
+static const LinkTableEntry OP3_WHOLE_BODY_LINKS[ALL_JOINT_ID + 1] =
+{
+  OP3_WHOLE_BODY_LINK_TABLE(OP3_LINK_TABLE_ENTRY)
+};
+
+#undef OP3_LINK_TABLE_ENTRY
+
+// compile-time view of a link, for kernels that are unrolled over a fixed chain.
+// every joint axis is a signed unit x, y or z vector (or zero for a fixed link)
+template<int ID>
+struct OP3LinkTrait;
+
+#define OP3_LINK_TRAIT(id, name, parent, sibling, child, mass, px, py, pz, ax, ay, az, cx, cy, cz, \
+                       ixx, ixy, ixz, iyy, iyz, izz, limit_max, limit_min) \
+  template<> \
+  struct OP3LinkTrait<id> \
+  { \
+    enum \
+    { \
+      PARENT = parent, \
+      AXIS_X = static_cast<int>(ax), \
+      AXIS_Y = static_cast<int>(ay), \
+      AXIS_Z = static_cast<int>(az) \
+    }; \
+    static Eigen::Vector3d getRelativePosition() \
+    { \
+      return Eigen::Vector3d(px, py, pz); \
+    } \
+  };
+
+OP3_WHOLE_BODY_LINK_TABLE(OP3_LINK_TRAIT)
+
+#undef OP3_LINK_TRAIT
+
+}
+
+#endif /* OP3_LINK_TABLE_H_ */
@@ -0,0 +1,235 @@
+/*******************************************************************************
+* Copyright 2017 ROBOTIS CO., LTD.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+/* Author: Kayman */
+
+#ifndef OP3_MODEL_H_
+#define OP3_MODEL_H_
+
+#include <string>
+#include <eigen3/Eigen/Eigen>
+
+#include "op3_kinematics_dynamics_define.h"
+#include "link_data.h"
+#include "joint_route.h"
+#include "kinematics_state.h"
+#include "inverse_kinematics_solver.h"
+#include "leg_ik_batch.h"
+#include "forward_kinematics_batch.h"
+#include "whole_body_ik.h"
+#include "support_polygon.h"
+
+namespace robotis_op
+{
+
+// indexed by link id, rows and columns of links without a joint stay 0
+typedef Eigen::Matrix<double, ALL_JOINT_ID + 1, ALL_JOINT_ID + 1> JointSpaceMatrix;
+// momentum about the COM per unit joint velocity, linear on the top rows and angular on the bottom
+typedef Eigen::Matrix<double, 6, ALL_JOINT_ID + 1> CentroidalMomentumMatrix;
+
+#define ARM_IK_MAX_SOLUTION (4)
+
+// every branch of the closed-form arm IK : shoulder pitch in front of or behind the shoulder, elbow either way.
+// joint[i] : shoulder pitch, shoulder roll, elbow
+struct ArmIKSolution
+{
+  int count;
+  double joint[ARM_IK_MAX_SOLUTION][MAX_ARM_ID];
+  bool within_limit[ARM_IK_MAX_SOLUTION];
+};
+
+// joint axes that are a signed unit vector get an elementary rotation instead of the general rodrigues formula
+enum JointAxisType
+{
+  JointAxisNone,
+  JointAxisX,
+  JointAxisY,
+  JointAxisZ,
+  JointAxisGeneral
+};
+
+// the constant part of the kinematics : link tree, masses, axes, limits and routes.
+// every member function is const and keeps its results in the given KinematicsState,
+// so one model can be shared by any number of threads without locking
+class OP3Model
+{
+ public:
+  OP3Model();
+  // compiles the tree linked by parent_/sibling_/child_ starting from link 0
+  explicit OP3Model(LinkData * const *link_data);
+  ~OP3Model();
+
+  int getLinkCount() const;
+  // -1 if there is no link with the name
+  int getLinkId(const std::string &link_name) const;
+  const std::string &getLinkName(int link_id) const;
+  const Eigen::Vector3d &getJointAxis(int link_id) const;
+  double getJointDirection(int link_id) const;
+  double getJointLimitMax(int link_id) const;
+  double getJointLimitMin(int link_id) const;
+
+  // precomputed routes, valid as long as this model lives
+  JointRoute getRoute(int to) const;
+  JointRoute getRoute(int from, int to) const;
+
+  double calcTotalMass(int joint_id) const;
+  Eigen::Vector3d calcMC(KinematicsState &state, int joint_id) const;
+  Eigen::Vector3d calcCOM(KinematicsState &state) const;
+
+  // FK of the link, its later siblings and all of their descendants
+  void calcForwardKinematics(KinematicsState &state, int joint_id = 0) const;
+  // recomputes only the links whose joint angle, or an ancestor's, changed since the last FK of the state
+  void updateKinematics(KinematicsState &state) const;
+  // FK of count configurations at once, joints without an array take the angle of the state
+  bool calcForwardKinematics(const KinematicsState &state, const JointAngleArray &angle, LinkPoseArray *link_pose,
+                             int link_pose_count, int count, int thread_count = 1) const;
+  // whole-body FK that also carries the link velocities and accelerations from the joint rates of the state,
+  // in the same pass. the base is fixed
+  void calcForwardKinematicsWithRates(KinematicsState &state) const;
+  // from the rates of the last calcForwardKinematicsWithRates
+  Eigen::Vector3d calcCOMVelocity(const KinematicsState &state) const;
+  Eigen::Vector3d calcCOMAcceleration(const KinematicsState &state) const;
+  // support polygon of the soles at the foot poses of the last FK (ID_R_LEG_END, ID_L_LEG_END).
+  // foot_size_x / y are the length and width of a sole, e.g. foot_size_x_ / foot_size_y_ of WalkingControl
+  void calcSupportPolygon(const KinematicsState &state, SupportPhase phase, double foot_size_x, double foot_size_y,
+                          SupportPolygon &polygon) const;
+  // signed distance of the ground projection of the COM to the polygon, positive inside
+  double calcCOMMargin(KinematicsState &state, const SupportPolygon &polygon) const;
+  // the same for the ZMP of the last FK with rates, false when the ZMP is not defined
+  bool calcZMPMargin(const KinematicsState &state, const SupportPolygon &polygon, double ground_height,
+                     double &margin) const;
+  // multibody ZMP on the plane z = ground_height of the base frame, including the change of angular momentum.
+  // false if the vertical ground force is too small (e.g. falling)
+  bool calcZMP(const KinematicsState &state, double ground_height, Eigen::Vector3d &zmp) const;
+
+  // recursive Newton-Euler with the base fixed and gravity along -z, from the joint angles, velocities and
+  // accelerations of the state. torque is indexed by link id, links without a joint get 0
+  void calcInverseDynamics(KinematicsState &state, double *torque) const;
+  // the same with zero joint velocity and acceleration, only the gravity term
+  void calcGravityTorque(KinematicsState &state, double *torque) const;
+  // composite-rigid-body algorithm, only the entries of a joint and its ancestors are non-zero
+  void calcMassMatrix(KinematicsState &state, JointSpaceMatrix &mass_matrix) const;
+  void calcCentroidalMomentumMatrix(KinematicsState &state, CentroidalMomentumMatrix &momentum_matrix) const;
+
+  void calcJacobian(const KinematicsState &state, const JointRoute &idx, IKJacobian &jacobian) const;
+  void calcJacobianCOM(KinematicsState &state, const JointRoute &idx, IKJacobian &jacobian) const;
+  IKError calcPoseError(const Eigen::Vector3d &tar_position, const Eigen::Vector3d &curr_position,
+                        const Eigen::Matrix3d &tar_orientation, const Eigen::Matrix3d &curr_orientation) const;
+
+  // numeric IK over a route, the policy follows state.ik_option_.
+  // weight is given per joint id, NULL for the unweighted solve
+  bool calcInverseKinematics(KinematicsState &state, const JointRoute &idx, int to,
+                             const Eigen::Vector3d &tar_position, const Eigen::Matrix3d &tar_orientation,
+                             int max_iter, double ik_err, const Eigen::MatrixXd *weight = NULL) const;
+  // instantiated for PseudoInverseIKPolicy, WeightedDampedIKPolicy and LevenbergMarquardtIKPolicy
+  template<typename IKPolicy>
+  bool solveInverseKinematics(KinematicsState &state, const JointRoute &idx, int to,
+                              const Eigen::Vector3d &tar_position, const Eigen::Matrix3d &tar_orientation,
+                              int max_iter, double ik_err, const IKPolicy &policy) const;
+
+  // one damped least-squares step towards the target, for targets that change every tick.
+  // the cost is bounded by the FK of the moved links and at most one 6x6 factorization (none when reused),
+  // the step respects the velocity limit of the option and the joint limits.
+  // true when the pose error was already within ik_err, the step is skipped then
+  bool calcDifferentialInverseKinematics(KinematicsState &state, const JointRoute &idx, int to,
+                                         const Eigen::Vector3d &tar_position, const Eigen::Matrix3d &tar_orientation,
+                                         double ik_err, const DifferentialIKOption &option) const;
+
+  // prioritized IK over the selected joints of the whole tree, one FK per iteration.
+  // tasks of one priority are stacked into a single damped solve, lower priorities and the posture only
+  // act in the null space of the higher ones. true when every task is within ik_err, with the limits
+  // and diagnostics handled as in calcInverseKinematics (no warm start)
+  bool calcWholeBodyInverseKinematics(KinematicsState &state, const WholeBodyIKProblem &problem, int max_iter,
+                                      double ik_err) const;
+
+  // closed-form leg IK, no state involved
+  bool calcInverseKinematicsForLeg(double *out, double x, double y, double z, double roll, double pitch,
+                                   double yaw) const;
+  bool calcInverseKinematicsForRightLeg(double *out, double x, double y, double z, double roll, double pitch,
+                                        double yaw) const;
+  bool calcInverseKinematicsForLeftLeg(double *out, double x, double y, double z, double roll, double pitch,
+                                       double yaw) const;
+  int calcInverseKinematicsForRightLeg(const LegPoseArray &pose, LegJointArray &out, int count) const;
+  int calcInverseKinematicsForLeftLeg(const LegPoseArray &pose, LegJointArray &out, int count) const;
+  LegIKParameter getLegIKParameter(int leg_start_id) const;
+
+  // closed-form arm IK of the arm end position, in the pelvis frame. arm_start_id is ID_R_ARM_START or
+  // ID_L_ARM_START. all branches are written to solution, returns how many of them are inside the joint limits
+  int calcInverseKinematicsForArm(int arm_start_id, const Eigen::Vector3d &tar_position,
+                                  ArmIKSolution &solution) const;
+  // the branch inside the joint limits nearest to curr_angle (3 joints, as in ArmIKSolution), false if none
+  bool calcInverseKinematicsForArm(double *out, int arm_start_id, const Eigen::Vector3d &tar_position,
+                                   const double *curr_angle) const;
+
+ private:
+  static const int LINK_NAME_TABLE_SIZE = 64;
+
+  static unsigned int hashLinkName(const std::string &link_name);
+  static JointAxisType classifyJointAxis(const Eigen::Vector3d &axis, double &sign);
+  // orientation = parent * R(axis of the link, joint_angle)
+  void rotateJoint(int link_id, const Eigen::Matrix3d &parent, double joint_angle, Eigen::Matrix3d &orientation) const;
+  // the joint axis of the link in the base frame, given its orientation
+  Eigen::Vector3d calcWorldJointAxis(int link_id, const Eigen::Matrix3d &orientation) const;
+  void calcLinkKinematics(KinematicsState &state, int pos) const;
+  void calcBranchMC(KinematicsState &state) const;
+  void calcSubtreeMomentum(KinematicsState &state, Eigen::Vector3d *linear, Eigen::Vector3d *angular) const;
+  IKJointVector getRouteWeight(const JointRoute &idx, const Eigen::MatrixXd &weight) const;
+  // rows of one whole-body task over the columns of the selected joints, returns the row count
+  int calcWholeBodyTask(KinematicsState &state, const WholeBodyIKTask &task, const int *column,
+                        Eigen::Matrix<double, 6, ALL_JOINT_ID + 1> &jacobian, IKError &err) const;
+  void applyWarmStart(KinematicsState &state, const JointRoute &idx, int to, const Eigen::Vector3d &tar_position,
+                      const Eigen::Matrix3d &tar_orientation) const;
+
+  int link_count_;
+
+  // indexed by position in the depth-first order (parents always come before their children)
+  int tree_order_[ALL_JOINT_ID + 1];          // link id at each position
+  int tree_parent_[ALL_JOINT_ID + 1];         // position of the parent, -1 for the root
+  int tree_sibling_[ALL_JOINT_ID + 1];        // position of the next sibling, -1 if none
+  int tree_child_[ALL_JOINT_ID + 1];          // position of the first child, -1 if none
+  int tree_branch_end_[ALL_JOINT_ID + 1];     // end of [link, later siblings and their descendants]
+  double tree_mass_[ALL_JOINT_ID + 1];
+  double tree_branch_mass_[ALL_JOINT_ID + 1];
+  Eigen::Vector3d tree_relative_position_[ALL_JOINT_ID + 1];
+  Eigen::Vector3d tree_joint_axis_[ALL_JOINT_ID + 1];
+  Eigen::Vector3d tree_center_of_mass_[ALL_JOINT_ID + 1];
+  Eigen::Matrix3d tree_inertia_[ALL_JOINT_ID + 1];
+
+  // indexed by link id
+  std::string link_name_[ALL_JOINT_ID + 1];
+  Eigen::Vector3d joint_axis_[ALL_JOINT_ID + 1];
+  JointAxisType joint_axis_type_[ALL_JOINT_ID + 1];
+  double joint_axis_sign_[ALL_JOINT_ID + 1];  // +1 or -1 for the unit axes
+  double joint_limit_max_[ALL_JOINT_ID + 1];
+  double joint_limit_min_[ALL_JOINT_ID + 1];
+  int tree_index_[ALL_JOINT_ID + 1];          // position of each link, -1 if it is not in the tree
+  int route_table_[ALL_JOINT_ID + 1][ALL_JOINT_ID + 1];  // route from the base to each link
+  int route_length_[ALL_JOINT_ID + 1];
+
+  // open addressing table of link ids keyed by name
+  int link_name_table_[LINK_NAME_TABLE_SIZE];
+
+  // closed-form leg IK
+  double hip_offset_angle_rad_;
+  double hip_pitch_offset_m_;
+  double thigh_length_m_;
+  double calf_length_m_;
+  double ankle_length_m_;
+};
+
+}
+
+#endif /* OP3_MODEL_H_ */
@@ -0,0 +1,71 @@
+/*******************************************************************************
+* Copyright 2017 ROBOTIS CO., LTD.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+/* Author: Kayman */
+
+#ifndef SUPPORT_POLYGON_H_
+#define SUPPORT_POLYGON_H_
+
+#include <eigen3/Eigen/Eigen>
+
+#include "op3_kinematics_dynamics_define.h"
+
+namespace robotis_op
+{
+
+#define SUPPORT_POLYGON_MAX_VERTEX (16)
+
+enum SupportPhase
+{
+  DoubleSupport,
+  RightLegSupport,
+  LeftLegSupport
+};
+
+// convex hull of ground contact points in the xy plane of the base frame, counterclockwise.
+// points are merged one at a time, so the hull is never rebuilt from scratch
+class SupportPolygon
+{
+ public:
+  SupportPolygon();
+
+  void clear();
+  // false when the hull has no room for the point, the hull is unchanged then
+  bool addPoint(double x, double y);
+  // the corners of a sole of size_x by size_y centered at position, turned by the yaw of orientation
+  bool addFoot(const Eigen::Vector3d &position, const Eigen::Matrix3d &orientation, double size_x, double size_y);
+
+  int getVertexCount() const;
+  Eigen::Vector2d getVertex(int index) const;
+
+  // signed distance from (x, y) to the line of each edge, positive on the inner side.
+  // edge i runs from vertex i to vertex i + 1, returns the edge count (0 below 3 vertices)
+  int calcEdgeDistance(double x, double y, double *distance) const;
+  // signed distance to the boundary, positive inside. -DBL_MAX below 3 vertices
+  double calcMargin(double x, double y) const;
+  bool isInside(double x, double y) const;
+
+ private:
+  double cross(int from, int to, double x, double y) const;
+
+  double vertex_x_[SUPPORT_POLYGON_MAX_VERTEX];
+  double vertex_y_[SUPPORT_POLYGON_MAX_VERTEX];
+  int vertex_count_;
+};
+
+}
+
+#endif /* SUPPORT_POLYGON_H_ */
@@ -0,0 +1,99 @@
+/*******************************************************************************
+* Copyright 2017 ROBOTIS CO., LTD.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+/* Author: Kayman */
+
+#ifndef WHOLE_BODY_IK_H_
+#define WHOLE_BODY_IK_H_
+
+#include <eigen3/Eigen/Eigen>
+
+#include "op3_kinematics_dynamics_define.h"
+
+namespace robotis_op
+{
+
+#define WHOLE_BODY_IK_MAX_TASK (8)
+
+enum WholeBodyIKTaskType
+{
+  PositionTask,     // position of link_id
+  OrientationTask,  // orientation of link_id
+  PoseTask,         // both
+  COMTask           // whole-body COM, link_id is not used
+};
+
+// one target of the whole-body IK, in the base frame
+struct WholeBodyIKTask
+{
+  WholeBodyIKTask()
+    : type(PoseTask),
+      link_id(-1),
+      priority(0),
+      weight(1.0),
+      target_position(Eigen::Vector3d::Zero()),
+      target_orientation(Eigen::Matrix3d::Identity())
+  {
+  }
+
+  WholeBodyIKTaskType type;
+  int link_id;
+  int priority;   // 0 is the highest. tasks of one priority are solved together
+  double weight;  // relative to the other tasks of the same priority
+  Eigen::Vector3d target_position;
+  Eigen::Matrix3d target_orientation;
+};
+
+// the tasks and settings of one whole-body solve
+struct WholeBodyIKProblem
+{
+  WholeBodyIKProblem()
+    : task_count(0),
+      posture_gain(0.0),
+      damping(1e-8),
+      max_step(0.2)
+  {
+    // the actuated joints by default, the passive joints hold the pose of the pelvis
+    for (int id = 0; id <= ALL_JOINT_ID; id++)
+    {
+      joint_select[id] = (id >= 1 && id <= MAX_JOINT_ID);
+      posture_angle[id] = 0.0;
+    }
+  }
+
+  // false when there is no room for another task
+  bool addTask(const WholeBodyIKTask &new_task)
+  {
+    if (task_count >= WHOLE_BODY_IK_MAX_TASK)
+      return false;
+
+    task[task_count++] = new_task;
+    return true;
+  }
+
+  WholeBodyIKTask task[WHOLE_BODY_IK_MAX_TASK];
+  int task_count;
+
+  bool joint_select[ALL_JOINT_ID + 1];     // joints the solve may move, by link id
+  double posture_angle[ALL_JOINT_ID + 1];  // by link id
+  double posture_gain;                     // pull towards posture_angle under every task, 0 for none
+  double damping;                          // added to the diagonal of each priority level
+  double max_step;                         // largest joint change per iteration [rad]
+};
+
+}
+
+#endif /* WHOLE_BODY_IK_H_ */
@@ -0,0 +1,204 @@
+/*******************************************************************************
+* Copyright 2017 ROBOTIS CO., LTD.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+/* Author: Kayman */
+
+#include <boost/thread.hpp>
+
+#include "op3_kinematics_dynamics/forward_kinematics_batch.h"
+#include "simd_pack.h"
+
+namespace robotis_op
+{
+
+namespace
+{
+
+using namespace simd;
+
+struct BatchJob
+{
+  const ForwardKinematicsBatchModel *model;
+  const LinkPoseArray *link_pose;
+  int link_pose_count;
+
+  bool needed[ALL_JOINT_ID + 1];             // on the way to a requested link
+  const double *input[ALL_JOINT_ID + 1];     // angle array per position, NULL for a fixed angle
+  double hat[ALL_JOINT_ID + 1][9];           // [axis]x
+  double hat_square[ALL_JOINT_ID + 1][9];    // [axis]x * [axis]x
+  bool rotates[ALL_JOINT_ID + 1];
+  int position_of[ALL_JOINT_ID + 1];         // position of each link id, -1 if not in the tree
+};
+
+// FK of P::SIZE configurations starting at index, same math as OP3KinematicsDynamics::calcForwardKinematics
+template<typename P>
+void solveForwardKinematicsBlock(const BatchJob &job, int index)
+{
+  const ForwardKinematicsBatchModel &model = *job.model;
+
+  P position[ALL_JOINT_ID + 1][3];
+  P orientation[ALL_JOINT_ID + 1][9];
+
+  for (int pos = 0; pos < model.link_count; pos++)
+  {
+    if (job.needed[pos] == false)
+      continue;
+
+    // joint rotation : I + sin * hat + (1 - cos) * hat^2
+    P rotation[9];
+    for (int ix = 0; ix < 9; ix++)
+      rotation[ix] = P::make((ix % 4 == 0) ? 1.0 : 0.0);
+
+    if (job.rotates[pos] == true)
+    {
+      P angle = (job.input[pos] != NULL) ? P::load(job.input[pos] + index) : P::make(model.joint_angle[pos]);
+      P s, c;
+      packSinCos(angle, s, c);
+      P one_minus_c = P::make(1.0) - c;
+
+      for (int ix = 0; ix < 9; ix++)
+        rotation[ix] = rotation[ix] + s * P::make(job.hat[pos][ix]) + one_minus_c * P::make(job.hat_square[pos][ix]);
+    }
+
+    int parent = model.parent[pos];
+    if (parent == -1)
+    {
+      for (int ix = 0; ix < 3; ix++)
+        position[pos][ix] = P::make(0.0);
+      for (int ix = 0; ix < 9; ix++)
+        orientation[pos][ix] = rotation[ix];
+      continue;
+    }
+
+    const P *parent_orientation = orientation[parent];
+    for (int row = 0; row < 3; row++)
+    {
+      position[pos][row] = position[parent][row]
+          + parent_orientation[3 * row + 0] * P::make(model.relative_position[pos][0])
+          + parent_orientation[3 * row + 1] * P::make(model.relative_position[pos][1])
+          + parent_orientation[3 * row + 2] * P::make(model.relative_position[pos][2]);
+
+      for (int col = 0; col < 3; col++)
+        orientation[pos][3 * row + col] = parent_orientation[3 * row + 0] * rotation[col]
+            + parent_orientation[3 * row + 1] * rotation[3 + col]
+            + parent_orientation[3 * row + 2] * rotation[6 + col];
+    }
+  }
+
+  for (int ix = 0; ix < job.link_pose_count; ix++)
+  {
+    const LinkPoseArray &link_pose = job.link_pose[ix];
+    int pos = job.position_of[link_pose.link_id];
+
+    for (int row = 0; row < 3; row++)
+      position[pos][row].store(link_pose.position[row] + index);
+
+    if (link_pose.orientation[0] == NULL)
+      continue;
+    for (int elem = 0; elem < 9; elem++)
+      orientation[pos][elem].store(link_pose.orientation[elem] + index);
+  }
+}
+
+void solveForwardKinematicsRange(const BatchJob *job, int begin, int end)
+{
+  int index = begin;
+
+#if defined(__AVX__)
+  for (; index + AVXPack::SIZE <= end; index += AVXPack::SIZE)
+    solveForwardKinematicsBlock<AVXPack>(*job, index);
+#endif
+#if defined(__SSE2__)
+  for (; index + SSE2Pack::SIZE <= end; index += SSE2Pack::SIZE)
+    solveForwardKinematicsBlock<SSE2Pack>(*job, index);
+#endif
+  for (; index < end; index++)
+    solveForwardKinematicsBlock<ScalarPack>(*job, index);
+}
+
+}
+
+bool calcForwardKinematicsBatch(const ForwardKinematicsBatchModel &model, const JointAngleArray &angle,
+                                LinkPoseArray *link_pose, int link_pose_count, int count, int thread_count)
+{
+  if (count <= 0 || link_pose_count <= 0)
+    return true;
+
+  BatchJob job;
+  job.model = &model;
+  job.link_pose = link_pose;
+  job.link_pose_count = link_pose_count;
+
+  for (int id = 0; id <= ALL_JOINT_ID; id++)
+    job.position_of[id] = -1;
+
+  for (int pos = 0; pos < model.link_count; pos++)
+  {
+    int id = model.link_id[pos];
+    const double *axis = model.joint_axis[pos];
+
+    job.position_of[id] = pos;
+    job.needed[pos] = false;
+    job.input[pos] = angle.joint_angle[id];
+    job.rotates[pos] = (axis[0] != 0.0 || axis[1] != 0.0 || axis[2] != 0.0);
+
+    double hat[9] = { 0.0, -axis[2], axis[1], axis[2], 0.0, -axis[0], -axis[1], axis[0], 0.0 };
+    for (int row = 0; row < 3; row++)
+    {
+      for (int col = 0; col < 3; col++)
+      {
+        job.hat[pos][3 * row + col] = hat[3 * row + col];
+        job.hat_square[pos][3 * row + col] = hat[3 * row + 0] * hat[col] + hat[3 * row + 1] * hat[3 + col]
+            + hat[3 * row + 2] * hat[6 + col];
+      }
+    }
+  }
+
+  // mark the requested links and their ancestors, any number of requests (the same link may come twice)
+  for (int ix = 0; ix < link_pose_count; ix++)
+  {
+    int id = link_pose[ix].link_id;
+    int pos = (id < 0 || id > ALL_JOINT_ID) ? -1 : job.position_of[id];
+
+    if (pos == -1)
+      return false;
+
+    for (; pos != -1 && job.needed[pos] == false; pos = model.parent[pos])
+      job.needed[pos] = true;
+  }
+
+  if (thread_count <= 1 || count < 2 * thread_count)
+  {
+    solveForwardKinematicsRange(&job, 0, count);
+    return true;
+  }
+
+  // contiguous chunks, rounded to whole packs of 4
+  int chunk = (count + thread_count - 1) / thread_count;
+  chunk = (chunk + 3) / 4 * 4;
+
+  boost::thread_group threads;
+  for (int begin = 0; begin < count; begin += chunk)
+  {
+    int end = (begin + chunk < count) ? begin + chunk : count;
+    threads.create_thread(boost::bind(&solveForwardKinematicsRange, &job, begin, end));
+  }
+  threads.join_all();
+
+  return true;
+}
+
+}
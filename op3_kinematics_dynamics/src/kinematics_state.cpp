@@ -0,0 +1,65 @@
+/*******************************************************************************
+* Copyright 2017 ROBOTIS CO., LTD.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+/* Author: Kayman */
+
+#include <limits>
+#include "op3_kinematics_dynamics/kinematics_state.h"
+
+namespace robotis_op
+{
+
+KinematicsState::KinematicsState()
+{
+  for (int id = 0; id <= ALL_JOINT_ID; id++)
+    pose_serial_[id] = 0;
+
+  reset();
+}
+
+KinematicsState::~KinematicsState()
+{
+}
+
+void KinematicsState::reset()
+{
+  for (int id = 0; id <= ALL_JOINT_ID; id++)
+  {
+    joint_angle_[id] = 0.0;
+    joint_velocity_[id] = 0.0;
+    joint_acceleration_[id] = 0.0;
+    position_[id].setZero();
+    orientation_[id].setIdentity();
+    pose_serial_[id]++;
+    linear_velocity_[id].setZero();
+    angular_velocity_[id].setZero();
+    linear_acceleration_[id].setZero();
+    angular_acceleration_[id].setZero();
+
+    fk_angle_[id] = std::numeric_limits<double>::quiet_NaN();  // never computed
+    ik_warm_start_joint_count_[id] = 0;
+  }
+
+  branch_mc_valid_ = false;
+
+  for (int ix = 0; ix < DIFFERENTIAL_IK_CACHE_SIZE; ix++)
+    differential_ik_cache_[ix].valid = false;
+  differential_ik_cache_next_ = 0;
+
+  ik_result_ = InverseKinematicsResult();
+}
+
+}
@@ -0,0 +1,149 @@
+/*******************************************************************************
+* Copyright 2017 ROBOTIS CO., LTD.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+/* Author: Kayman */
+
+#include "op3_kinematics_dynamics/leg_ik_batch.h"
+#include "simd_pack.h"
+
+namespace robotis_op
+{
+
+namespace
+{
+
+using namespace simd;
+
+// the same steps as OP3KinematicsDynamics::calcInverseKinematicsForLeg, with the 3x3 products expanded
+template<typename P>
+void solveLegBlock(const LegIKParameter &param, const LegPoseArray &pose, LegJointArray &out, int index)
+{
+  const P zero = P::make(0.0);
+  const P one = P::make(1.0);
+
+  P sr, cr, sp, cp, sy, cy;
+  packSinCos(P::load(pose.roll + index), sr, cr);
+  packSinCos(P::load(pose.pitch + index), sp, cp);
+  packSinCos(P::load(pose.yaw + index), sy, cy);
+
+  // R06 = Rz(yaw) * Ry(pitch) * Rx(roll)
+  P r00 = cy * cp, r01 = cy * sp * sr - sy * cr, r02 = cy * sp * cr + sy * sr;
+  P r10 = sy * cp, r11 = sy * sp * sr + cy * cr, r12 = sy * sp * cr - cy * sr;
+  P r20 = -sp, r21 = cp * sr, r22 = cp * cr;
+
+  // desired hip to ankle
+  P ankle = P::make(param.ankle_length_m);
+  P p06_x = P::load(pose.x + index) + ankle * r02;
+  P p06_y = P::load(pose.y + index) + ankle * r12;
+  P p06_z = P::load(pose.z + index) + ankle * r22;
+
+  // q6
+  P p60_y = -(r01 * p06_x + r11 * p06_y + r21 * p06_z);
+  P p60_z = -(r02 * p06_x + r12 * p06_y + r22 * p06_z);
+  P q6 = packAtan2(p60_y, p60_z);
+
+  // R05 = R06 * Rx(-q6)
+  P s6, c6;
+  packSinCos(q6, s6, c6);
+  P r05_01 = r01 * c6 - r02 * s6, r05_02 = r01 * s6 + r02 * c6;
+  P r05_11 = r11 * c6 - r12 * s6, r05_12 = r11 * s6 + r12 * c6;
+  P r05_21 = r21 * c6 - r22 * s6;
+
+  // q1
+  P q1 = packAtan2(-r05_01, r05_11);
+  P s1, c1;
+  packSinCos(q1, s1, c1);
+
+  // q4
+  P hip_pitch_offset = P::make(param.hip_pitch_offset_m);
+  P p36_x = p06_x - hip_pitch_offset * c1;
+  P p36_y = p06_y - hip_pitch_offset * s1;
+  P p36_z = p06_z;
+  P p36_norm = packSqrt(p36_x * p36_x + p36_y * p36_y + p36_z * p36_z);
+
+  P thigh = P::make(param.thigh_length_m);
+  P calf = P::make(param.calf_length_m);
+  P cos_knee = (thigh * thigh + calf * calf - p36_norm * p36_norm) / (P::make(2.0) * thigh * calf);
+  P sin_knee = packSqrt(one - cos_knee * cos_knee);  // NaN when the pose is out of reach
+  P q4 = P::make(M_PI) - packAtan2(sin_knee, cos_knee);
+
+  // q5
+  P sin_alpha = thigh * sin_knee / p36_norm;
+  P alpha = packAtan2(sin_alpha, packSqrt(one - sin_alpha * sin_alpha));
+  P p63_x = -(r00 * p36_x + r10 * p36_y + r20 * p36_z);
+  P p63_y = -(r01 * p36_x + r11 * p36_y + r21 * p36_z);
+  P p63_z = -(r02 * p36_x + r12 * p36_y + r22 * p36_z);
+  P sign_z = select(lessThan(p63_z, zero), -one, one);
+  P q5 = -packAtan2(p63_x, sign_z * packSqrt(p63_y * p63_y + p63_z * p63_z)) - alpha;
+
+  // q2 and q3 from R13 = Rz(-q1) * R05 * Ry(-(q4 + q5))
+  P s45, c45;
+  packSinCos(q4 + q5, s45, c45);
+  P n00 = c1 * r00 + s1 * r10;
+  P n02 = c1 * r05_02 + s1 * r05_12;
+  P r13_00 = n00 * c45 + n02 * s45;
+  P r13_02 = n02 * c45 - n00 * s45;
+  P r13_11 = c1 * r05_11 - s1 * r05_01;
+  P q2 = packAtan2(r05_21, r13_11);
+  P q3 = packAtan2(r13_02, r13_00);
+
+  P offset = P::make(param.hip_offset_angle_rad);
+  P joint[MAX_LEG_ID] = { q1, q2, q3 + offset, q4 - offset, q5, q6 };
+
+  typename P::Mask valid = equal(zero, zero);
+  for (int ix = 0; ix < MAX_LEG_ID; ix++)
+  {
+    joint[ix] = joint[ix] * P::make(param.joint_direction[ix]);
+    joint[ix].store(out.joint[ix] + index);
+
+    // comparisons with NaN are false, so unreachable poses drop out here too
+    valid = valid & lessEqual(P::make(param.joint_limit_min[ix]), joint[ix])
+        & lessEqual(joint[ix], P::make(param.joint_limit_max[ix]));
+  }
+
+  if (out.valid != NULL)
+    storeMask(valid, out.valid + index);
+}
+
+}
+
+int calcLegInverseKinematicsBatch(const LegIKParameter &param, const LegPoseArray &pose, LegJointArray &out,
+                                  int count)
+{
+  int index = 0;
+
+#if defined(__AVX__)
+  for (; index + AVXPack::SIZE <= count; index += AVXPack::SIZE)
+    solveLegBlock<AVXPack>(param, pose, out, index);
+#endif
+#if defined(__SSE2__)
+  for (; index + SSE2Pack::SIZE <= count; index += SSE2Pack::SIZE)
+    solveLegBlock<SSE2Pack>(param, pose, out, index);
+#endif
+  for (; index < count; index++)
+    solveLegBlock<ScalarPack>(param, pose, out, index);
+
+  if (out.valid == NULL)
+    return count;
+
+  int valid_count = 0;
+  for (int ix = 0; ix < count; ix++)
+    valid_count += out.valid[ix];
+
+  return valid_count;
+}
+
+}
@@ -0,0 +1,346 @@
+/*******************************************************************************
+* Copyright 2017 ROBOTIS CO., LTD.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+/* Author: Kayman */
+
+#include <cmath>
+#include <cstdio>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "op3_kinematics_dynamics/leg_reachability_map.h"
+#include "op3_kinematics_dynamics/op3_model.h"
+
+namespace robotis_op
+{
+
+LegReachabilityMap::LegReachabilityMap()
+  : inverse_voxel_size_(0.0),
+    cell_(NULL),
+    cell_count_(0),
+    mapped_data_(NULL),
+    mapped_size_(0)
+{
+  header_ = LegReachabilityMapHeader();
+}
+
+LegReachabilityMap::~LegReachabilityMap()
+{
+  unload();
+}
+
+bool LegReachabilityMap::build(const OP3Model &model, const LegReachabilityMapOption &option)
+{
+  if (option.voxel_size <= 0.0 || option.yaw_sample_count < 1
+      || option.yaw_sample_count > LEG_REACHABILITY_MAP_MAX_YAW_SAMPLE || option.yaw_max < 0.0)
+    return false;
+
+  LegReachabilityMapHeader header = LegReachabilityMapHeader();
+  header.magic = MAGIC;
+  header.version = VERSION;
+  header.yaw_sample_count = option.yaw_sample_count;
+  header.voxel_size = option.voxel_size;
+  header.yaw_max = option.yaw_max;
+
+  for (int axis = 0; axis < 3; axis++)
+  {
+    if (option.max[axis] <= option.min[axis])
+      return false;
+
+    header.origin[axis] = option.min[axis];
+    header.size[axis] = static_cast<uint32_t>(ceil((option.max[axis] - option.min[axis]) / option.voxel_size));
+  }
+
+  int size_x = header.size[0];
+  int yaw_count = header.yaw_sample_count;
+  int cell_count = header.size[0] * header.size[1] * header.size[2];
+
+  double yaw_sample[LEG_REACHABILITY_MAP_MAX_YAW_SAMPLE];
+  int zero_yaw = 0;
+  for (int k = 0; k < yaw_count; k++)
+  {
+    yaw_sample[k] = (yaw_count == 1) ? 0.0 : -option.yaw_max + k * 2.0 * option.yaw_max / (yaw_count - 1);
+    if (fabs(yaw_sample[k]) < fabs(yaw_sample[zero_yaw]))
+      zero_yaw = k;
+  }
+
+  // the samples nearest to zero yaw first, the manipulability is taken at the first reachable one
+  int yaw_order[LEG_REACHABILITY_MAP_MAX_YAW_SAMPLE];
+  for (int k = 0; k < yaw_count; k++)
+    yaw_order[k] = k;
+  for (int k = 1; k < yaw_count; k++)
+    for (int j = k; j > 0 && fabs(yaw_sample[yaw_order[j]]) < fabs(yaw_sample[yaw_order[j - 1]]); j--)
+    {
+      int swap = yaw_order[j];
+      yaw_order[j] = yaw_order[j - 1];
+      yaw_order[j - 1] = swap;
+    }
+
+  // one row of x at a time, every yaw sample in the same batch
+  int batch_count = size_x * yaw_count;
+  std::vector<double> pose_x(batch_count), pose_y(batch_count), pose_z(batch_count);
+  std::vector<double> pose_roll(batch_count, 0.0), pose_pitch(batch_count, 0.0), pose_yaw(batch_count);
+  std::vector<double> joint(MAX_LEG_ID * batch_count);
+  std::vector<unsigned char> valid(batch_count);
+
+  LegPoseArray pose = { &pose_x[0], &pose_y[0], &pose_z[0], &pose_roll[0], &pose_pitch[0], &pose_yaw[0] };
+  LegJointArray out;
+  for (int ix = 0; ix < MAX_LEG_ID; ix++)
+    out.joint[ix] = &joint[ix * batch_count];
+  out.valid = &valid[0];
+
+  std::vector<LegReachabilityCell> cell(2 * cell_count);
+  std::vector<double> manipulability(2 * cell_count, 0.0);
+  double max_manipulability = 0.0;
+
+  KinematicsState state;
+  model.calcForwardKinematics(state);
+
+  const int leg_start_id[2] = { ID_R_LEG_START, ID_L_LEG_START };
+  const int leg_end_id[2] = { ID_R_LEG_END, ID_L_LEG_END };
+
+  for (int leg = 0; leg < 2; leg++)
+  {
+    LegIKParameter param = model.getLegIKParameter(leg_start_id[leg]);
+    JointRoute route = model.getRoute(leg_start_id[leg], leg_end_id[leg]);
+    IKJacobian jacobian;
+
+    for (uint32_t iz = 0; iz < header.size[2]; iz++)
+    {
+      for (uint32_t iy = 0; iy < header.size[1]; iy++)
+      {
+        for (int ix = 0; ix < size_x; ix++)
+        {
+          for (int k = 0; k < yaw_count; k++)
+          {
+            int index = ix * yaw_count + k;
+            pose_x[index] = header.origin[0] + (ix + 0.5) * header.voxel_size;
+            pose_y[index] = header.origin[1] + (iy + 0.5) * header.voxel_size;
+            pose_z[index] = header.origin[2] + (iz + 0.5) * header.voxel_size;
+            pose_yaw[index] = yaw_sample[k];
+          }
+        }
+
+        calcLegInverseKinematicsBatch(param, pose, out, batch_count);
+
+        for (int ix = 0; ix < size_x; ix++)
+        {
+          int cell_index = leg * cell_count + (iz * header.size[1] + iy) * size_x + ix;
+          LegReachabilityCell &curr_cell = cell[cell_index];
+
+          curr_cell.yaw_mask = 0;
+          curr_cell.manipulability = 0;
+
+          for (int k = 0; k < yaw_count; k++)
+            if (valid[ix * yaw_count + k] != 0)
+              curr_cell.yaw_mask |= (1 << k);
+
+          if (curr_cell.yaw_mask == 0)
+            continue;
+
+          int yaw_index = 0;
+          for (int k = 0; k < yaw_count; k++)
+          {
+            if (valid[ix * yaw_count + yaw_order[k]] != 0)
+            {
+              yaw_index = ix * yaw_count + yaw_order[k];
+              break;
+            }
+          }
+
+          for (int joint_index = 0; joint_index < MAX_LEG_ID; joint_index++)
+            state.joint_angle_[leg_start_id[leg] + 2 * joint_index] = out.joint[joint_index][yaw_index];
+          model.updateKinematics(state);
+          model.calcJacobian(state, route, jacobian);
+
+          double det = (jacobian * jacobian.transpose()).determinant();
+          manipulability[cell_index] = (det > 0.0) ? sqrt(det) : 0.0;
+          if (manipulability[cell_index] > max_manipulability)
+            max_manipulability = manipulability[cell_index];
+        }
+      }
+    }
+  }
+
+  if (max_manipulability > 0.0)
+  {
+    for (int ix = 0; ix < 2 * cell_count; ix++)
+      cell[ix].manipulability = static_cast<uint8_t>(floor(255.0 * manipulability[ix] / max_manipulability + 0.5));
+  }
+  header.max_manipulability = max_manipulability;
+
+  unload();
+
+  header_ = header;
+  inverse_voxel_size_ = 1.0 / header.voxel_size;
+  cell_count_ = cell_count;
+  cell_buffer_.swap(cell);
+  cell_ = &cell_buffer_[0];
+
+  return true;
+}
+
+bool LegReachabilityMap::save(const std::string &path) const
+{
+  if (isLoaded() == false)
+    return false;
+
+  FILE *file = fopen(path.c_str(), "wb");
+  if (file == NULL)
+    return false;
+
+  bool result = (fwrite(&header_, sizeof(header_), 1, file) == 1)
+      && (fwrite(cell_, sizeof(LegReachabilityCell), 2 * cell_count_, file) == static_cast<size_t>(2 * cell_count_));
+
+  if (fclose(file) != 0)
+    result = false;
+
+  return result;
+}
+
+bool LegReachabilityMap::load(const std::string &path)
+{
+  unload();
+
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+    return false;
+
+  struct stat file_stat;
+  if (fstat(fd, &file_stat) != 0 || file_stat.st_size < static_cast<off_t>(sizeof(LegReachabilityMapHeader)))
+  {
+    close(fd);
+    return false;
+  }
+
+  size_t size = file_stat.st_size;
+  void *data = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+
+  if (data == MAP_FAILED)
+    return false;
+
+  const LegReachabilityMapHeader *header = static_cast<const LegReachabilityMapHeader *>(data);
+  size_t cell_count = static_cast<size_t>(header->size[0]) * header->size[1] * header->size[2];
+
+  if (header->magic != MAGIC || header->version != VERSION || header->voxel_size <= 0.0
+      || header->yaw_sample_count < 1 || header->yaw_sample_count > LEG_REACHABILITY_MAP_MAX_YAW_SAMPLE
+      || size != sizeof(LegReachabilityMapHeader) + 2 * cell_count * sizeof(LegReachabilityCell))
+  {
+    munmap(data, size);
+    return false;
+  }
+
+  header_ = *header;
+  inverse_voxel_size_ = 1.0 / header_.voxel_size;
+  cell_count_ = cell_count;
+  cell_ = reinterpret_cast<const LegReachabilityCell *>(static_cast<const char *>(data)
+                                                        + sizeof(LegReachabilityMapHeader));
+  mapped_data_ = data;
+  mapped_size_ = size;
+
+  return true;
+}
+
+void LegReachabilityMap::unload()
+{
+  if (mapped_data_ != NULL)
+    munmap(mapped_data_, mapped_size_);
+
+  mapped_data_ = NULL;
+  mapped_size_ = 0;
+  std::vector<LegReachabilityCell>().swap(cell_buffer_);
+  cell_ = NULL;
+  cell_count_ = 0;
+}
+
+bool LegReachabilityMap::isLoaded() const
+{
+  return (cell_ != NULL);
+}
+
+const LegReachabilityMapHeader &LegReachabilityMap::getHeader() const
+{
+  return header_;
+}
+
+const LegReachabilityCell *LegReachabilityMap::findCell(int leg_start_id, double x, double y, double z) const
+{
+  if (cell_ == NULL)
+    return NULL;
+
+  int leg;
+  if (leg_start_id == ID_R_LEG_START)
+    leg = 0;
+  else if (leg_start_id == ID_L_LEG_START)
+    leg = 1;
+  else
+    return NULL;
+
+  double fx = (x - header_.origin[0]) * inverse_voxel_size_;
+  double fy = (y - header_.origin[1]) * inverse_voxel_size_;
+  double fz = (z - header_.origin[2]) * inverse_voxel_size_;
+
+  // written so that NaN also falls outside
+  if (!(fx >= 0.0 && fx < header_.size[0] && fy >= 0.0 && fy < header_.size[1] && fz >= 0.0 && fz < header_.size[2]))
+    return NULL;
+
+  int index = (static_cast<int>(fz) * header_.size[1] + static_cast<int>(fy)) * header_.size[0] + static_cast<int>(fx);
+
+  return cell_ + leg * cell_count_ + index;
+}
+
+bool LegReachabilityMap::isReachable(int leg_start_id, double x, double y, double z) const
+{
+  const LegReachabilityCell *cell = findCell(leg_start_id, x, y, z);
+
+  return (cell != NULL && cell->yaw_mask != 0);
+}
+
+bool LegReachabilityMap::isReachable(int leg_start_id, double x, double y, double z, double yaw) const
+{
+  const LegReachabilityCell *cell = findCell(leg_start_id, x, y, z);
+  if (cell == NULL)
+    return false;
+
+  int yaw_index = 0;
+  if (header_.yaw_sample_count > 1)
+  {
+    double step = 2.0 * header_.yaw_max / (header_.yaw_sample_count - 1);
+    double sample = (yaw + header_.yaw_max) / step + 0.5;
+
+    if (!(sample >= 0.0 && sample < header_.yaw_sample_count))
+      return false;
+    yaw_index = static_cast<int>(sample);
+  }
+  else if (!(fabs(yaw) <= header_.yaw_max))
+    return false;
+
+  return ((cell->yaw_mask >> yaw_index) & 1) != 0;
+}
+
+double LegReachabilityMap::getManipulability(int leg_start_id, double x, double y, double z) const
+{
+  const LegReachabilityCell *cell = findCell(leg_start_id, x, y, z);
+  if (cell == NULL)
+    return 0.0;
+
+  return cell->manipulability / 255.0;
+}
+
+}
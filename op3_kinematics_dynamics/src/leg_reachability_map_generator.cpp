@@ -0,0 +1,60 @@
+/*******************************************************************************
+* Copyright 2017 ROBOTIS CO., LTD.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+/* Author: Kayman */
+
+// offline generator of the leg reachability map
+// usage : leg_reachability_map_generator <output file> [voxel size (m)]
+
+#include <cstdlib>
+#include <iostream>
+
+#include "op3_kinematics_dynamics/op3_kinematics_dynamics.h"
+#include "op3_kinematics_dynamics/leg_reachability_map.h"
+
+int main(int argc, char **argv)
+{
+  if (argc < 2)
+  {
+    std::cout << "usage : " << argv[0] << " <output file> [voxel size (m)]" << std::endl;
+    return 1;
+  }
+
+  robotis_op::LegReachabilityMapOption option;
+  if (argc > 2)
+    option.voxel_size = atof(argv[2]);
+
+  robotis_op::OP3KinematicsDynamics op3_kd(robotis_op::WholeBody);
+  robotis_op::LegReachabilityMap map;
+
+  if (map.build(op3_kd.getModel(), option) == false)
+  {
+    std::cout << "failed to build the map" << std::endl;
+    return 1;
+  }
+
+  if (map.save(argv[1]) == false)
+  {
+    std::cout << "failed to write " << argv[1] << std::endl;
+    return 1;
+  }
+
+  const robotis_op::LegReachabilityMapHeader &header = map.getHeader();
+  std::cout << "wrote " << argv[1] << " : " << header.size[0] << " x " << header.size[1] << " x " << header.size[2]
+            << " voxels of " << header.voxel_size << " m, " << header.yaw_sample_count << " yaw samples" << std::endl;
+
+  return 0;
+}
@@ -45,11 +45,26 @@ LinkData::LinkData()
 
   position_ = robotis_framework::getTransitionXYZ(0.0, 0.0, 0.0);
   orientation_ = robotis_framework::convertRPYToRotation(0.0, 0.0, 0.0);
-  transformation_ = robotis_framework::getTransformationXYZRPY(0.0, 0.0, 0.0, 0.0, 0.0, 0.0);
+  transformation_.setIdentity();
 }
 
 LinkData::~LinkData()
 {
 }
 
+Eigen::MatrixXd LinkData::getPosition() const
+{
+  return position_;
+}
+
+Eigen::MatrixXd LinkData::getOrientation() const
+{
+  return orientation_;
+}
+
+Eigen::MatrixXd LinkData::getTransformation() const
+{
+  return transformation_.matrix();
+}
+
 }
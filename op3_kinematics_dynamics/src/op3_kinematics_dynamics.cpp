@@ -18,20 +18,17 @@
 
 #include <iostream>
 #include "op3_kinematics_dynamics/op3_kinematics_dynamics.h"
+#include "op3_kinematics_dynamics/op3_link_table.h"
 
 namespace robotis_op
 {
 
-double getSign(double num)
-{
-  if(num < 0)
-    return -1.0;
-  else
-    return 1.0;
-}
-
 OP3KinematicsDynamics::OP3KinematicsDynamics()
 {
+  resetPreviewParamCache();
+
+  for (int id = 0; id <= ALL_JOINT_ID; id++)
+    pushed_pose_serial_[id] = state_.pose_serial_[id] - 1;
 }
 OP3KinematicsDynamics::~OP3KinematicsDynamics()
 {
@@ -39,530 +36,123 @@ OP3KinematicsDynamics::~OP3KinematicsDynamics()
 
 OP3KinematicsDynamics::OP3KinematicsDynamics(TreeSelect tree)
 {
+  resetPreviewParamCache();
+
+  for (int id = 0; id <= ALL_JOINT_ID; id++)
+    pushed_pose_serial_[id] = state_.pose_serial_[id] - 1;
+
   for (int id = 0; id <= ALL_JOINT_ID; id++)
     op3_link_data_[id] = new LinkData();
 
   if (tree == WholeBody)
   {
-    op3_link_data_[0]->name_ = "base";
-    op3_link_data_[0]->parent_ = -1;
-    op3_link_data_[0]->sibling_ = -1;
-    op3_link_data_[0]->child_ = 23;
-    op3_link_data_[0]->mass_ = 0.0;
-    op3_link_data_[0]->relative_position_ = robotis_framework::getTransitionXYZ(0.0, 0.0, 0.0);
-    op3_link_data_[0]->joint_axis_ = robotis_framework::getTransitionXYZ(0.0, 0.0, 0.0);
-    op3_link_data_[0]->center_of_mass_ = robotis_framework::getTransitionXYZ(0.0, 0.0, 0.0);
-    op3_link_data_[0]->joint_limit_max_ = 100.0;
-    op3_link_data_[0]->joint_limit_min_ = -100.0;
-    op3_link_data_[0]->inertia_ = robotis_framework::getInertiaXYZ(0.0, 0.0, 0.0, 0.0, 0.0, 0.0);
-
-    /* ----- passive joint -----*/
-
-    op3_link_data_[23]->name_ = "passive_x";
-    op3_link_data_[23]->parent_ = 0;
-    op3_link_data_[23]->sibling_ = -1;
-    op3_link_data_[23]->child_ = 24;
-    op3_link_data_[23]->mass_ = 0.0;
-    op3_link_data_[23]->relative_position_ = robotis_framework::getTransitionXYZ(0.0, 0.0, 0.0);
-    op3_link_data_[23]->joint_axis_ = robotis_framework::getTransitionXYZ(0.0, 0.0, 0.0);
-    op3_link_data_[23]->center_of_mass_ = robotis_framework::getTransitionXYZ(0.0, 0.0, 0.0);
-    op3_link_data_[23]->joint_limit_max_ = 100.0;
-    op3_link_data_[23]->joint_limit_min_ = -100.0;
-    op3_link_data_[23]->inertia_ = robotis_framework::getInertiaXYZ(0.0, 0.0, 0.0, 0.0, 0.0, 0.0);
-
-    op3_link_data_[24]->name_ = "passive_y";
-    op3_link_data_[24]->parent_ = 23;
-    op3_link_data_[24]->sibling_ = -1;
-    op3_link_data_[24]->child_ = 25;
-    op3_link_data_[24]->mass_ = 0.0;
-    op3_link_data_[24]->relative_position_ = robotis_framework::getTransitionXYZ(0.0, 0.0, 0.0);
-    op3_link_data_[24]->joint_axis_ = robotis_framework::getTransitionXYZ(0.0, 0.0, 0.0);
-    op3_link_data_[24]->center_of_mass_ = robotis_framework::getTransitionXYZ(0.0, 0.0, 0.0);
-    op3_link_data_[24]->joint_limit_max_ = 100.0;
-    op3_link_data_[24]->joint_limit_min_ = -100.0;
-    op3_link_data_[24]->inertia_ = robotis_framework::getInertiaXYZ(0.0, 0.0, 0.0, 0.0, 0.0, 0.0);
-
-    op3_link_data_[25]->name_ = "passive_z";
-    op3_link_data_[25]->parent_ = 24;
-    op3_link_data_[25]->sibling_ = -1;
-    op3_link_data_[25]->child_ = 26;
-    op3_link_data_[25]->mass_ = 0.0;
-    op3_link_data_[25]->relative_position_ = robotis_framework::getTransitionXYZ(0.0, 0.0, 0.385);
-    op3_link_data_[25]->joint_axis_ = robotis_framework::getTransitionXYZ(0.0, 0.0, 0.0);
-    op3_link_data_[25]->center_of_mass_ = robotis_framework::getTransitionXYZ(0.0, 0.0, 0.0);
-    op3_link_data_[25]->joint_limit_max_ = 100.0;
-    op3_link_data_[25]->joint_limit_min_ = -100.0;
-    op3_link_data_[25]->inertia_ = robotis_framework::getInertiaXYZ(0.0, 0.0, 0.0, 0.0, 0.0, 0.0);
-
-    op3_link_data_[26]->name_ = "passive_yaw";
-    op3_link_data_[26]->parent_ = 25;
-    op3_link_data_[26]->sibling_ = -1;
-    op3_link_data_[26]->child_ = 27;
-    op3_link_data_[26]->mass_ = 0.0;
-    op3_link_data_[26]->relative_position_ = robotis_framework::getTransitionXYZ(0.0, 0.0, 0.0);
-    op3_link_data_[26]->joint_axis_ = robotis_framework::getTransitionXYZ(0.0, 0.0, 1.0);
-    op3_link_data_[26]->center_of_mass_ = robotis_framework::getTransitionXYZ(0.0, 0.0, 0.0);
-    op3_link_data_[26]->joint_limit_max_ = 100.0;
-    op3_link_data_[26]->joint_limit_min_ = -100.0;
-    op3_link_data_[26]->inertia_ = robotis_framework::getInertiaXYZ(0.0, 0.0, 0.0, 0.0, 0.0, 0.0);
-
-    op3_link_data_[27]->name_ = "passive_pitch";
-    op3_link_data_[27]->parent_ = 26;
-    op3_link_data_[27]->sibling_ = -1;
-    op3_link_data_[27]->child_ = 28;
-    op3_link_data_[27]->mass_ = 0.0;
-    op3_link_data_[27]->relative_position_ = robotis_framework::getTransitionXYZ(0.0, 0.0, 0.0);
-    op3_link_data_[27]->joint_axis_ = robotis_framework::getTransitionXYZ(0.0, 1.0, 0.0);
-    op3_link_data_[27]->center_of_mass_ = robotis_framework::getTransitionXYZ(0.0, 0.0, 0.0);
-    op3_link_data_[27]->joint_limit_max_ = 100.0;
-    op3_link_data_[27]->joint_limit_min_ = -100.0;
-    op3_link_data_[27]->inertia_ = robotis_framework::getInertiaXYZ(0.0, 0.0, 0.0, 0.0, 0.0, 0.0);
-
-    op3_link_data_[28]->name_ = "passive_roll";
-    op3_link_data_[28]->parent_ = 27;
-    op3_link_data_[28]->sibling_ = -1;
-    op3_link_data_[28]->child_ = 29;
-    op3_link_data_[28]->mass_ = 0.0;
-    op3_link_data_[28]->relative_position_ = robotis_framework::getTransitionXYZ(0.0, 0.0, 0.0);
-    op3_link_data_[28]->joint_axis_ = robotis_framework::getTransitionXYZ(1.0, 0.0, 0.0);
-    op3_link_data_[28]->center_of_mass_ = robotis_framework::getTransitionXYZ(0.0, 0.0, 0.0);
-    op3_link_data_[28]->joint_limit_max_ = 100.0;
-    op3_link_data_[28]->joint_limit_min_ = -100.0;
-    op3_link_data_[28]->inertia_ = robotis_framework::getInertiaXYZ(0.0, 0.0, 0.0, 0.0, 0.0, 0.0);
-
-    /* ----- body -----*/
-
-    // pelvis_link
-    op3_link_data_[29]->name_ = "pelvis";
-    op3_link_data_[29]->parent_ = 28;
-    op3_link_data_[29]->sibling_ = -1;
-    op3_link_data_[29]->child_ = 19;
-    op3_link_data_[29]->mass_ = 1.3492787;
-    op3_link_data_[29]->relative_position_ = robotis_framework::getTransitionXYZ(0.0, 0.0, 0.0);
-    op3_link_data_[29]->joint_axis_ = robotis_framework::getTransitionXYZ(0.0, 0.0, 0.0);
-    op3_link_data_[29]->center_of_mass_ = robotis_framework::getTransitionXYZ(-0.015014868, 0.00013099, 0.065815797);
-    op3_link_data_[29]->joint_limit_max_ = 100.0;
-    op3_link_data_[29]->joint_limit_min_ = -100.0;
-    op3_link_data_[29]->inertia_ = robotis_framework::getInertiaXYZ(0.03603, 0.00000, 0.00016, 0.02210, 0.00000,
-                                                                    0.03830);
-
-    /* ----- head -----*/
-
-    // head_pan
-    op3_link_data_[19]->name_ = "head_pan";
-    op3_link_data_[19]->parent_ = 29;
-    op3_link_data_[19]->sibling_ = 1;
-    op3_link_data_[19]->child_ = 20;
-    op3_link_data_[19]->mass_ = 0.011759436;
-    op3_link_data_[19]->relative_position_ = robotis_framework::getTransitionXYZ(-0.001, 0.0, 0.1365);
-    op3_link_data_[19]->joint_axis_ = robotis_framework::getTransitionXYZ(0.0, 0.0, 1.0);
-    op3_link_data_[19]->center_of_mass_ = robotis_framework::getTransitionXYZ(0.002327479, 0, 0.008227847);
-    op3_link_data_[19]->joint_limit_max_ = 0.5 * M_PI;
-    op3_link_data_[19]->joint_limit_min_ = -0.5 * M_PI;
-    op3_link_data_[19]->inertia_ = robotis_framework::getInertiaXYZ(0.00011, 0.00000, 0.00000, 0.00003, 0.00000,
-                                                                    0.00012);
-
-    // head_tilt
-    op3_link_data_[20]->name_ = "head_tilt";
-    op3_link_data_[20]->parent_ = 19;
-    op3_link_data_[20]->sibling_ = -1;
-    op3_link_data_[20]->child_ = -1;
-    op3_link_data_[20]->mass_ = 0.13630649;
-    op3_link_data_[20]->relative_position_ = robotis_framework::getTransitionXYZ(0.01, 0.019, 0.0285);
-    op3_link_data_[20]->joint_axis_ = robotis_framework::getTransitionXYZ(0.0, -1.0, 0.0);
-    op3_link_data_[20]->center_of_mass_ = robotis_framework::getTransitionXYZ(0.002298411, -0.018634079, 0.027696734);
-    op3_link_data_[20]->joint_limit_max_ = 0.5 * M_PI;
-    op3_link_data_[20]->joint_limit_min_ = -0.5 * M_PI;
-    op3_link_data_[20]->inertia_ = robotis_framework::getInertiaXYZ(0.00113, 0.00001, -0.00005, 0.00114, 0.00002,
-                                                                    0.00084);
-
-    /*----- right arm -----*/
-
-    // right arm shoulder pitch
-    op3_link_data_[1]->name_ = "r_sho_pitch";
-    op3_link_data_[1]->parent_ = 29;
-    op3_link_data_[1]->sibling_ = 2;
-    op3_link_data_[1]->child_ = 3;
-    op3_link_data_[1]->mass_ = 0.011759436;
-    op3_link_data_[1]->relative_position_ = robotis_framework::getTransitionXYZ(-0.001, -0.06, 0.111);
-    op3_link_data_[1]->joint_axis_ = robotis_framework::getTransitionXYZ(0.0, -1.0, 0.0);
-    op3_link_data_[1]->center_of_mass_ = robotis_framework::getTransitionXYZ(0, -0.008227847, -0.002327479);
-    op3_link_data_[1]->joint_limit_max_ = 0.5 * M_PI;
-    op3_link_data_[1]->joint_limit_min_ = -0.5 * M_PI;
-    op3_link_data_[1]->inertia_ = robotis_framework::getInertiaXYZ(0.00018, 0.0, 0.0, 0.00058, -0.00004, 0.00057);
-
-    // right arm shoulder roll
-    op3_link_data_[3]->name_ = "r_sho_roll";
-    op3_link_data_[3]->parent_ = 1;
-    op3_link_data_[3]->sibling_ = -1;
-    op3_link_data_[3]->child_ = 5;
-    op3_link_data_[3]->mass_ = 0.1775763;
-    op3_link_data_[3]->relative_position_ = robotis_framework::getTransitionXYZ(0.019, -0.0285, -0.01);
-    op3_link_data_[3]->joint_axis_ = robotis_framework::getTransitionXYZ(-1.0, 0.0, 0.0);
-    op3_link_data_[3]->center_of_mass_ = robotis_framework::getTransitionXYZ(-0.018438243, -0.045143767, 0.000281212);
-    op3_link_data_[3]->joint_limit_max_ = 0.3 * M_PI;
-    op3_link_data_[3]->joint_limit_min_ = -0.5 * M_PI;
-    op3_link_data_[3]->inertia_ = robotis_framework::getInertiaXYZ(0.00043, 0.00000, 0.00000, 0.00112, 0.00000,
-                                                                   0.00113);
-
-    // right arm elbow
-    op3_link_data_[5]->name_ = "r_el";
-    op3_link_data_[5]->parent_ = 3;
-    op3_link_data_[5]->sibling_ = -1;
-    op3_link_data_[5]->child_ = 21;
-    op3_link_data_[5]->mass_ = 0.041267974;
-    op3_link_data_[5]->relative_position_ = robotis_framework::getTransitionXYZ(0, -0.0904, -0.0001);
-    op3_link_data_[5]->joint_axis_ = robotis_framework::getTransitionXYZ(1.0, 0.0, 0.0);
-    op3_link_data_[5]->center_of_mass_ = robotis_framework::getTransitionXYZ(-0.019000003, -0.070330391, 0.00380012);
-    op3_link_data_[5]->joint_limit_max_ = 0.5 * M_PI;
-    op3_link_data_[5]->joint_limit_min_ = -0.5 * M_PI;
-    op3_link_data_[5]->inertia_ = robotis_framework::getInertiaXYZ(0.00277, 0.00002, -0.00001, 0.00090, 0.00004,
-                                                                   0.00255);
-
-    // right arm end effector
-    op3_link_data_[21]->name_ = "r_arm_end";
-    op3_link_data_[21]->parent_ = 5;
-    op3_link_data_[21]->sibling_ = -1;
-    op3_link_data_[21]->child_ = -1;
-    op3_link_data_[21]->mass_ = 0.0;
-    op3_link_data_[21]->relative_position_ = robotis_framework::getTransitionXYZ(0.0, -0.15, 0.0);
-    op3_link_data_[21]->joint_axis_ = robotis_framework::getTransitionXYZ(0.0, 0.0, 0.0);
-    op3_link_data_[21]->center_of_mass_ = robotis_framework::getTransitionXYZ(0.0, 0.0, 0.0);
-    op3_link_data_[21]->joint_limit_max_ = 100.0;
-    op3_link_data_[21]->joint_limit_min_ = -100.0;
-    op3_link_data_[21]->inertia_ = robotis_framework::getInertiaXYZ(0.0, 0.0, 0.0, 0.0, 0.0, 0.0);
-
-    /*----- left arm -----*/
-
-    // left arm shoulder pitch
-    op3_link_data_[2]->name_ = "l_sho_pitch";
-    op3_link_data_[2]->parent_ = 29;
-    op3_link_data_[2]->sibling_ = 7;
-    op3_link_data_[2]->child_ = 4;
-    op3_link_data_[2]->mass_ = 0.011759436;
-    op3_link_data_[2]->relative_position_ = robotis_framework::getTransitionXYZ(-0.001, 0.06, 0.111);
-    op3_link_data_[2]->joint_axis_ = robotis_framework::getTransitionXYZ(0.0, 1.0, 0.0);
-    op3_link_data_[2]->center_of_mass_ = robotis_framework::getTransitionXYZ(0, 0.008227847, -0.002327479);
-    op3_link_data_[2]->joint_limit_max_ = 0.5 * M_PI;
-    op3_link_data_[2]->joint_limit_min_ = -0.5 * M_PI;
-    op3_link_data_[2]->inertia_ = robotis_framework::getInertiaXYZ(0.00018, 0.00000, 0.00000, 0.00058, 0.00004,
-                                                                   0.00057);
-
-    // left arm shoulder roll
-    op3_link_data_[4]->name_ = "l_sho_roll";
-    op3_link_data_[4]->parent_ = 2;
-    op3_link_data_[4]->sibling_ = -1;
-    op3_link_data_[4]->child_ = 6;
-    op3_link_data_[4]->mass_ = 0.1775763;
-    op3_link_data_[4]->relative_position_ = robotis_framework::getTransitionXYZ(0.019, 0.0285, -0.01);
-    op3_link_data_[4]->joint_axis_ = robotis_framework::getTransitionXYZ(-1.0, 0.0, 0.0);
-    op3_link_data_[4]->center_of_mass_ = robotis_framework::getTransitionXYZ(-0.018438243, 0.045143767, 0.000281212);
-    op3_link_data_[4]->joint_limit_max_ = 0.5 * M_PI;
-    op3_link_data_[4]->joint_limit_min_ = -0.3 * M_PI;
-    op3_link_data_[4]->inertia_ = robotis_framework::getInertiaXYZ(0.00043, 0.00000, 0.00000, 0.00112, 0.00000,
-                                                                   0.00113);
-
-    // left arm elbow
-    op3_link_data_[6]->name_ = "l_el";
-    op3_link_data_[6]->parent_ = 4;
-    op3_link_data_[6]->sibling_ = -1;
-    op3_link_data_[6]->child_ = 22;
-    op3_link_data_[6]->mass_ = 0.041267974;
-    op3_link_data_[6]->relative_position_ = robotis_framework::getTransitionXYZ(0, 0.0904, -0.0001);
-    op3_link_data_[6]->joint_axis_ = robotis_framework::getTransitionXYZ(1.0, 0.0, 0.0);
-    op3_link_data_[6]->center_of_mass_ = robotis_framework::getTransitionXYZ(-0.018999997, 0.070330391, 0.003800117);
-    op3_link_data_[6]->joint_limit_max_ = 0.5 * M_PI;
-    op3_link_data_[6]->joint_limit_min_ = -0.5 * M_PI;
-    op3_link_data_[6]->inertia_ = robotis_framework::getInertiaXYZ(0.00277, -0.00002, -0.00001, 0.00090, -0.00004,
-                                                                   0.00255);
-
-    // left arm end effector
-    op3_link_data_[22]->name_ = "l_arm_end";
-    op3_link_data_[22]->parent_ = 6;
-    op3_link_data_[22]->sibling_ = -1;
-    op3_link_data_[22]->child_ = -1;
-    op3_link_data_[22]->mass_ = 0.0;
-    op3_link_data_[22]->relative_position_ = robotis_framework::getTransitionXYZ(0.0, 0.15, 0.0);
-    op3_link_data_[22]->joint_axis_ = robotis_framework::getTransitionXYZ(0.0, 0.0, 0.0);
-    op3_link_data_[22]->center_of_mass_ = robotis_framework::getTransitionXYZ(0.0, 0.0, 0.0);
-    op3_link_data_[22]->joint_limit_max_ = 100.0;
-    op3_link_data_[22]->joint_limit_min_ = -100.0;
-    op3_link_data_[22]->inertia_ = robotis_framework::getInertiaXYZ(0.0, 0.0, 0.0, 0.0, 0.0, 0.0);
-
-    /* ----- right leg -----*/
-
-    // right leg hip yaw
-    op3_link_data_[7]->name_ = "r_hip_yaw";
-    op3_link_data_[7]->parent_ = 29;
-    op3_link_data_[7]->sibling_ = 8;
-    op3_link_data_[7]->child_ = 9;
-    op3_link_data_[7]->mass_ = 0.011813898;
-    op3_link_data_[7]->relative_position_ = robotis_framework::getTransitionXYZ(0, -0.035, 0);
-    op3_link_data_[7]->joint_axis_ = robotis_framework::getTransitionXYZ(0.0, 0.0, -1.0);
-    op3_link_data_[7]->center_of_mass_ = robotis_framework::getTransitionXYZ(-0.001566062, 0, -0.00774017);
-    op3_link_data_[7]->joint_limit_max_ = 0.45 * M_PI;
-    op3_link_data_[7]->joint_limit_min_ = -0.45 * M_PI;
-    op3_link_data_[7]->inertia_ = robotis_framework::getInertiaXYZ(0.00024, 0.00000, 0.00000, 0.00101, 0.00000,
-                                                                   0.00092);
-
-    // right leg hip roll
-    op3_link_data_[9]->name_ = "r_hip_roll";
-    op3_link_data_[9]->parent_ = 7;
-    op3_link_data_[9]->sibling_ = -1;
-    op3_link_data_[9]->child_ = 11;
-    op3_link_data_[9]->mass_ = 0.17885985;
-    op3_link_data_[9]->relative_position_ = robotis_framework::getTransitionXYZ(-0.024, 0, -0.0285);
-    op3_link_data_[9]->joint_axis_ = robotis_framework::getTransitionXYZ(-1.0, 0.0, 0.0);
-    op3_link_data_[9]->center_of_mass_ = robotis_framework::getTransitionXYZ(0.00388263, -0.000278863, -0.012138713);
-    op3_link_data_[9]->joint_limit_max_ = 0.3 * M_PI;
-    op3_link_data_[9]->joint_limit_min_ = -0.3 * M_PI;
-    op3_link_data_[9]->inertia_ = robotis_framework::getInertiaXYZ(0.00056, 0.00000, 0.00000, 0.00168, 0.00000,
-                                                                   0.00171);
-
-    // right leg hip pitch
-    op3_link_data_[11]->name_ = "r_hip_pitch";
-    op3_link_data_[11]->parent_ = 9;
-    op3_link_data_[11]->sibling_ = -1;
-    op3_link_data_[11]->child_ = 13;
-    op3_link_data_[11]->mass_ = 0.11543381;
-    op3_link_data_[11]->relative_position_ = robotis_framework::getTransitionXYZ(0.0241, -0.019, 0);
-    op3_link_data_[11]->joint_axis_ = robotis_framework::getTransitionXYZ(0.0, -1.0, 0.0);
-    op3_link_data_[11]->center_of_mass_ = robotis_framework::getTransitionXYZ(0.000590366, 0.019005093, -0.084075186);
-    op3_link_data_[11]->joint_limit_max_ = 0.4 * M_PI;
-    op3_link_data_[11]->joint_limit_min_ = -0.4 * M_PI;
-    op3_link_data_[11]->inertia_ = robotis_framework::getInertiaXYZ(0.04329, -0.00027, 0.00286, 0.04042, 0.00203,
-                                                                    0.00560);
-
-    // right leg knee
-    op3_link_data_[13]->name_ = "r_knee";
-    op3_link_data_[13]->parent_ = 11;
-    op3_link_data_[13]->sibling_ = -1;
-    op3_link_data_[13]->child_ = 15;
-    op3_link_data_[13]->mass_ = 0.040146918;
-    op3_link_data_[13]->relative_position_ = robotis_framework::getTransitionXYZ(0.0001, 0,	-0.11015);
-    op3_link_data_[13]->joint_axis_ = robotis_framework::getTransitionXYZ(0.0, -1.0, 0.0);
-    op3_link_data_[13]->center_of_mass_ = robotis_framework::getTransitionXYZ(0, 0.021514031, -0.055);
-    op3_link_data_[13]->joint_limit_max_ = 0.1 * M_PI;
-    op3_link_data_[13]->joint_limit_min_ = -0.7 * M_PI;
-    op3_link_data_[13]->inertia_ = robotis_framework::getInertiaXYZ(0.01971, -0.00031, -0.00294, 0.01687, -0.00140,
-                                                                    0.00574);
-
-    // right leg ankle pitch
-    op3_link_data_[15]->name_ = "r_ank_pitch";
-    op3_link_data_[15]->parent_ = 13;
-    op3_link_data_[15]->sibling_ = -1;
-    op3_link_data_[15]->child_ = 17;
-    op3_link_data_[15]->mass_ = 0.17885985;
-    op3_link_data_[15]->relative_position_ = robotis_framework::getTransitionXYZ(0, 0, -0.11);
-    op3_link_data_[15]->joint_axis_ = robotis_framework::getTransitionXYZ(0.0, 1.0, 0.0);
-    op3_link_data_[15]->center_of_mass_ = robotis_framework::getTransitionXYZ(-0.02021737, 0.018721137, 0.012138713);
-    op3_link_data_[15]->joint_limit_max_ = 0.45 * M_PI;
-    op3_link_data_[15]->joint_limit_min_ = -0.45 * M_PI;
-    op3_link_data_[15]->inertia_ = robotis_framework::getInertiaXYZ(0.00056, 0.00000, 0.00000, 0.00168, 0.00000,
-                                                                    0.00171);
-
-    // right leg ankle roll
-    op3_link_data_[17]->name_ = "r_ank_roll";
-    op3_link_data_[17]->parent_ = 15;
-    op3_link_data_[17]->sibling_ = -1;
-    op3_link_data_[17]->child_ = 31;
-    op3_link_data_[17]->mass_ = 0.069344849;
-    op3_link_data_[17]->relative_position_ = robotis_framework::getTransitionXYZ(-0.0241, 0.019, 0);
-    op3_link_data_[17]->joint_axis_ = robotis_framework::getTransitionXYZ(1.0, 0.0, 0.0);
-    op3_link_data_[17]->center_of_mass_ = robotis_framework::getTransitionXYZ(0.023733194, -0.010370444, -0.027601507);
-    op3_link_data_[17]->joint_limit_max_ = 0.45 * M_PI;
-    op3_link_data_[17]->joint_limit_min_ = -0.45 * M_PI;
-    op3_link_data_[17]->inertia_ = robotis_framework::getInertiaXYZ(0.00022, 0.00000, -0.00001, 0.00099, 0.00000,
-                                                                    0.00091);
-
-    // right leg end
-    op3_link_data_[31]->name_ = "r_leg_end";
-    op3_link_data_[31]->parent_ = 17;
-    op3_link_data_[31]->sibling_ = -1;
-    op3_link_data_[31]->child_ = -1;
-    op3_link_data_[31]->mass_ = 0.0;
-    op3_link_data_[31]->relative_position_ = robotis_framework::getTransitionXYZ(0.024, 0.0, -0.0305);
-    op3_link_data_[31]->joint_axis_ = robotis_framework::getTransitionXYZ(0.0, 0.0, 0.0);
-    op3_link_data_[31]->center_of_mass_ = robotis_framework::getTransitionXYZ(0.0, 0.0, 0.0);
-    op3_link_data_[31]->joint_limit_max_ = 100.0;
-    op3_link_data_[31]->joint_limit_min_ = -100.0;
-    op3_link_data_[31]->inertia_ = robotis_framework::getInertiaXYZ(0.0, 0.0, 0.0, 0.0, 0.0, 0.0);
-
-    /* ----- left leg -----*/
-
-    // left leg hip yaw
-    op3_link_data_[8]->name_ = "l_hip_yaw";
-    op3_link_data_[8]->parent_ = 29;
-    op3_link_data_[8]->sibling_ = -1;
-    op3_link_data_[8]->child_ = 10;
-    op3_link_data_[8]->mass_ = 0.011813898;
-    op3_link_data_[8]->relative_position_ = robotis_framework::getTransitionXYZ(0, 0.035, 0);
-    op3_link_data_[8]->joint_axis_ = robotis_framework::getTransitionXYZ(0.0, 0.0, -1.0);
-    op3_link_data_[8]->center_of_mass_ = robotis_framework::getTransitionXYZ(-0.001566062, 0, -0.00774017);
-    op3_link_data_[8]->joint_limit_max_ = 0.45 * M_PI;
-    op3_link_data_[8]->joint_limit_min_ = -0.45 * M_PI;
-    op3_link_data_[8]->inertia_ = robotis_framework::getInertiaXYZ(0.00024, 0.00000, 0.00000, 0.00101, 0.00000,
-                                                                   0.00092);
-
-    // left leg hip roll
-    op3_link_data_[10]->name_ = "l_hip_roll";
-    op3_link_data_[10]->parent_ = 8;
-    op3_link_data_[10]->sibling_ = -1;
-    op3_link_data_[10]->child_ = 12;
-    op3_link_data_[10]->mass_ = 0.17885985;
-    op3_link_data_[10]->relative_position_ = robotis_framework::getTransitionXYZ(-0.024, 0, -0.0285);
-    op3_link_data_[10]->joint_axis_ = robotis_framework::getTransitionXYZ(-1.0, 0.0, 0.0);
-    op3_link_data_[10]->center_of_mass_ = robotis_framework::getTransitionXYZ(0.00388263, 0.000278863, -0.012138713);
-    op3_link_data_[10]->joint_limit_max_ = 0.3 * M_PI;
-    op3_link_data_[10]->joint_limit_min_ = -0.3 * M_PI;
-    op3_link_data_[10]->inertia_ = robotis_framework::getInertiaXYZ(0.00056, 0.00000, 0.00000, 0.00168, 0.00000,
-                                                                    0.00171);
-
-    // left leg hip pitch
-    op3_link_data_[12]->name_ = "l_hip_pitch";
-    op3_link_data_[12]->parent_ = 10;
-    op3_link_data_[12]->sibling_ = -1;
-    op3_link_data_[12]->child_ = 14;
-    op3_link_data_[12]->mass_ = 0.11543381;
-    op3_link_data_[12]->relative_position_ = robotis_framework::getTransitionXYZ(0.0241, 0.019, 0);
-    op3_link_data_[12]->joint_axis_ = robotis_framework::getTransitionXYZ(0.0, 1.0, 0.0);
-    op3_link_data_[12]->center_of_mass_ = robotis_framework::getTransitionXYZ(0.000590367, -0.019005093, -0.084075186);
-    op3_link_data_[12]->joint_limit_max_ = 0.4 * M_PI;
-    op3_link_data_[12]->joint_limit_min_ = -0.4 * M_PI;
-    op3_link_data_[12]->inertia_ = robotis_framework::getInertiaXYZ(0.04328, 0.00028, 0.00288, 0.04042, -0.00202,
-                                                                    0.00560);
-
-    // left leg knee pitch
-    op3_link_data_[14]->name_ = "l_knee";
-    op3_link_data_[14]->parent_ = 12;
-    op3_link_data_[14]->sibling_ = -1;
-    op3_link_data_[14]->child_ = 16;
-    op3_link_data_[14]->mass_ = 0.040146918;
-    op3_link_data_[14]->relative_position_ = robotis_framework::getTransitionXYZ(0.0001, 0, -0.11015);
-    op3_link_data_[14]->joint_axis_ = robotis_framework::getTransitionXYZ(0.0, 1.0, 0.0);
-    op3_link_data_[14]->center_of_mass_ = robotis_framework::getTransitionXYZ(0, -0.021514031, -0.055);
-    op3_link_data_[14]->joint_limit_max_ = 0.7 * M_PI;
-    op3_link_data_[14]->joint_limit_min_ = -0.1 * M_PI;
-    op3_link_data_[14]->inertia_ = robotis_framework::getInertiaXYZ(0.01971, 0.00031, -0.00294, 0.01687, 0.00140,
-                                                                    0.00574);
-
-    // left leg ankle pitch
-    op3_link_data_[16]->name_ = "l_ank_pitch";
-    op3_link_data_[16]->parent_ = 14;
-    op3_link_data_[16]->sibling_ = -1;
-    op3_link_data_[16]->child_ = 18;
-    op3_link_data_[16]->mass_ = 0.17885985;
-    op3_link_data_[16]->relative_position_ = robotis_framework::getTransitionXYZ(0.000, 0.000, -0.110);
-    op3_link_data_[16]->joint_axis_ = robotis_framework::getTransitionXYZ(0.0, -1.0, 0.0);
-    op3_link_data_[16]->center_of_mass_ = robotis_framework::getTransitionXYZ(-0.02021825, -0.018721131, 0.012138988);
-    op3_link_data_[16]->joint_limit_max_ = 0.45 * M_PI;
-    op3_link_data_[16]->joint_limit_min_ = -0.45 * M_PI;
-    op3_link_data_[16]->inertia_ = robotis_framework::getInertiaXYZ(0.00056, 0.00000, 0.00000, 0.00168, 0.00000,
-                                                                    0.00171);
-
-    // left leg ankle roll
-    op3_link_data_[18]->name_ = "l_ank_roll";
-    op3_link_data_[18]->parent_ = 16;
-    op3_link_data_[18]->sibling_ = -1;
-    op3_link_data_[18]->child_ = 30;
-    op3_link_data_[18]->mass_ = 0.069344849;
-    op3_link_data_[18]->relative_position_ = robotis_framework::getTransitionXYZ(-0.0241, -0.019, 0);
-    op3_link_data_[18]->joint_axis_ = robotis_framework::getTransitionXYZ(1.0, 0.0, 0.0);
-    op3_link_data_[18]->center_of_mass_ = robotis_framework::getTransitionXYZ(0.023733194, 0.010370444, -0.027601507);
-    op3_link_data_[18]->joint_limit_max_ = 0.45 * M_PI;
-    op3_link_data_[18]->joint_limit_min_ = -0.45 * M_PI;
-    op3_link_data_[18]->inertia_ = robotis_framework::getInertiaXYZ(0.00022, 0.00000, -0.00001, 0.00099, 0.00000,
-                                                                    0.00091);
-
-    // left leg end
-    op3_link_data_[30]->name_ = "l_leg_end";
-    op3_link_data_[30]->parent_ = 18;
-    op3_link_data_[30]->sibling_ = -1;
-    op3_link_data_[30]->child_ = -1;
-    op3_link_data_[30]->mass_ = 0.0;
-    op3_link_data_[30]->relative_position_ = robotis_framework::getTransitionXYZ(0.024, 0.0, -0.0305);
-    op3_link_data_[30]->joint_axis_ = robotis_framework::getTransitionXYZ(0.0, 0.0, 0.0);
-    op3_link_data_[30]->center_of_mass_ = robotis_framework::getTransitionXYZ(0.0, 0.0, 0.0);
-    op3_link_data_[30]->joint_limit_max_ = 100.0;
-    op3_link_data_[30]->joint_limit_min_ = -100.0;
-    op3_link_data_[30]->inertia_ = robotis_framework::getInertiaXYZ(0.0, 0.0, 0.0, 0.0, 0.0, 0.0);
+    for (int ix = 0; ix <= ALL_JOINT_ID; ix++)
+    {
+      const LinkTableEntry &entry = OP3_WHOLE_BODY_LINKS[ix];
+      LinkData *link = op3_link_data_[entry.id];
+
+      link->name_ = entry.name;
+      link->parent_ = entry.parent;
+      link->sibling_ = entry.sibling;
+      link->child_ = entry.child;
+      link->mass_ = entry.mass;
+      link->relative_position_ = robotis_framework::getTransitionXYZ(entry.relative_position[0],
+                                                                     entry.relative_position[1],
+                                                                     entry.relative_position[2]);
+      link->joint_axis_ = robotis_framework::getTransitionXYZ(entry.joint_axis[0], entry.joint_axis[1],
+                                                              entry.joint_axis[2]);
+      link->center_of_mass_ = robotis_framework::getTransitionXYZ(entry.center_of_mass[0], entry.center_of_mass[1],
+                                                                  entry.center_of_mass[2]);
+      link->joint_limit_max_ = entry.joint_limit_max;
+      link->joint_limit_min_ = entry.joint_limit_min;
+      link->inertia_ = robotis_framework::getInertiaXYZ(entry.inertia[0], entry.inertia[1], entry.inertia[2],
+                                                        entry.inertia[3], entry.inertia[4], entry.inertia[5]);
+    }
   }
-  
-  hip_offset_angle_rad_ = atan2(0.0001, 0.11015);
-  hip_pitch_offset_m_ = 0.0001;
-  thigh_length_m_ = sqrt(op3_link_data_[ID_R_LEG_START + 2 * 3]->relative_position_.coeff(0, 0)*op3_link_data_[ID_R_LEG_START + 2 * 3]->relative_position_.coeff(0, 0)
-                               + op3_link_data_[ID_R_LEG_START + 2 * 3]->relative_position_.coeff(2, 0)*op3_link_data_[ID_R_LEG_START + 2 * 3]->relative_position_.coeff(2, 0));
-  calf_length_m_ = std::fabs(op3_link_data_[ID_R_LEG_START + 2 * 4]->relative_position_.coeff(2, 0));
-  ankle_length_m_ = std::fabs(op3_link_data_[ID_R_LEG_END]->relative_position_.coeff(2, 0));
+
+  model_ = OP3Model(op3_link_data_);
+
+  LegIKParameter leg_param = model_.getLegIKParameter(ID_R_LEG_START);
+  hip_offset_angle_rad_ = leg_param.hip_offset_angle_rad;
+  hip_pitch_offset_m_ = leg_param.hip_pitch_offset_m;
+  thigh_length_m_ = leg_param.thigh_length_m;
+  calf_length_m_ = leg_param.calf_length_m;
+  ankle_length_m_ = leg_param.ankle_length_m;
   leg_side_offset_m_ = 2.0 * (std::fabs(op3_link_data_[ID_R_LEG_START]->relative_position_.coeff(1, 0)));
 }
 
-std::vector<int> OP3KinematicsDynamics::findRoute(int to)
+const OP3Model &OP3KinematicsDynamics::getModel() const
 {
-  int id = op3_link_data_[to]->parent_;
+  return model_;
+}
 
-  std::vector<int> idx;
+KinematicsState &OP3KinematicsDynamics::getKinematicsState()
+{
+  return state_;
+}
 
-  if (id == 0)
+void OP3KinematicsDynamics::pullJointState()
+{
+  for (int id = 0; id <= ALL_JOINT_ID; id++)
   {
-    idx.push_back(0);
-    idx.push_back(to);
+    state_.joint_angle_[id] = op3_link_data_[id]->joint_angle_;
+    state_.joint_velocity_[id] = op3_link_data_[id]->joint_velocity_;
+    state_.joint_acceleration_[id] = op3_link_data_[id]->joint_acceleration_;
   }
-  else
+}
+
+void OP3KinematicsDynamics::pushKinematics()
+{
+  for (int id = 0; id <= ALL_JOINT_ID; id++)
   {
-    idx = findRoute(id);
-    idx.push_back(to);
+    LinkData *link = op3_link_data_[id];
+
+    link->joint_angle_ = state_.joint_angle_[id];
+
+    // only the links recomputed since the last copy, so an unchanged update stays close to a no-op
+    if (state_.pose_serial_[id] == pushed_pose_serial_[id])
+      continue;
+    pushed_pose_serial_[id] = state_.pose_serial_[id];
+
+    link->position_ = state_.position_[id];
+    link->orientation_ = state_.orientation_[id];
+    link->transformation_.linear() = link->orientation_;
+    link->transformation_.translation() = link->position_;
   }
+}
 
-  return idx;
+std::vector<int> OP3KinematicsDynamics::findRoute(int to)
+{
+  JointRoute route = getRoute(to);
+
+  return std::vector<int>(route.begin(), route.end());
 }
 
 std::vector<int> OP3KinematicsDynamics::findRoute(int from, int to)
 {
-  int id = op3_link_data_[to]->parent_;
+  JointRoute route = getRoute(from, to);
 
-  std::vector<int> idx;
+  return std::vector<int>(route.begin(), route.end());
+}
 
-  if (id == from)
-  {
-    idx.push_back(from);
-    idx.push_back(to);
-  }
-  else if (id != 0)
-  {
-    idx = findRoute(from, id);
-    idx.push_back(to);
-  }
+JointRoute OP3KinematicsDynamics::getRoute(int to) const
+{
+  return model_.getRoute(to);
+}
 
-  return idx;
+JointRoute OP3KinematicsDynamics::getRoute(int from, int to) const
+{
+  return model_.getRoute(from, to);
 }
 
 double OP3KinematicsDynamics::calcTotalMass(int joint_id)
 {
-  double mass;
-
-  if (joint_id == -1)
-    mass = 0.0;
-  else
-    mass = op3_link_data_[joint_id]->mass_ + calcTotalMass(op3_link_data_[joint_id]->sibling_)
-        + calcTotalMass(op3_link_data_[joint_id]->child_);
-
-  return mass;
+  return model_.calcTotalMass(joint_id);
 }
 
 Eigen::MatrixXd OP3KinematicsDynamics::calcMC(int joint_id)
 {
-  Eigen::MatrixXd mc(3, 1);
-
-  if (joint_id == -1)
-    mc = Eigen::MatrixXd::Zero(3, 1);
-  else
-  {
-    mc = op3_link_data_[joint_id]->mass_
-        * (op3_link_data_[joint_id]->orientation_ * op3_link_data_[joint_id]->center_of_mass_
-            + op3_link_data_[joint_id]->position_);
-    mc = mc + calcMC(op3_link_data_[joint_id]->sibling_) + calcMC(op3_link_data_[joint_id]->child_);
-  }
+  Eigen::MatrixXd mc = model_.calcMC(state_, joint_id);
 
   return mc;
 }
@@ -580,75 +170,114 @@ Eigen::MatrixXd OP3KinematicsDynamics::calcCOM(Eigen::MatrixXd mc)
 
 void OP3KinematicsDynamics::calcForwardKinematics(int joint_id)
 {
-  if (joint_id == -1)
-    return;
+  pullJointState();
+  model_.calcForwardKinematics(state_, joint_id);
+  pushKinematics();
+}
 
-  if (joint_id == 0)
-  {
-    op3_link_data_[0]->position_ = Eigen::MatrixXd::Zero(3, 1);
-    op3_link_data_[0]->orientation_ = robotis_framework::calcRodrigues(
-        robotis_framework::calcHatto(op3_link_data_[0]->joint_axis_), op3_link_data_[0]->joint_angle_);
-  }
+void OP3KinematicsDynamics::updateKinematics()
+{
+  pullJointState();
+  model_.updateKinematics(state_);
+  pushKinematics();
+}
 
-  if (joint_id != 0)
-  {
-    int parent = op3_link_data_[joint_id]->parent_;
+bool OP3KinematicsDynamics::calcForwardKinematics(const JointAngleArray &angle, LinkPoseArray *link_pose,
+                                                  int link_pose_count, int count, int thread_count)
+{
+  pullJointState();
 
-    op3_link_data_[joint_id]->position_ = op3_link_data_[parent]->orientation_
-        * op3_link_data_[joint_id]->relative_position_ + op3_link_data_[parent]->position_;
-    op3_link_data_[joint_id]->orientation_ = op3_link_data_[parent]->orientation_
-        * robotis_framework::calcRodrigues(robotis_framework::calcHatto(op3_link_data_[joint_id]->joint_axis_),
-                                           op3_link_data_[joint_id]->joint_angle_);
+  return model_.calcForwardKinematics(state_, angle, link_pose, link_pose_count, count, thread_count);
+}
 
-    op3_link_data_[joint_id]->transformation_.block<3, 1>(0, 3) = op3_link_data_[joint_id]->position_;
-    op3_link_data_[joint_id]->transformation_.block<3, 3>(0, 0) = op3_link_data_[joint_id]->orientation_;
-  }
+void OP3KinematicsDynamics::calcForwardKinematicsWithRates()
+{
+  pullJointState();
+  model_.calcForwardKinematicsWithRates(state_);
+  pushKinematics();
+}
 
-  calcForwardKinematics(op3_link_data_[joint_id]->sibling_);
-  calcForwardKinematics(op3_link_data_[joint_id]->child_);
+Eigen::Vector3d OP3KinematicsDynamics::calcCOMVelocity()
+{
+  return model_.calcCOMVelocity(state_);
 }
 
-Eigen::MatrixXd OP3KinematicsDynamics::calcJacobian(std::vector<int> idx)
+Eigen::Vector3d OP3KinematicsDynamics::calcCOMAcceleration()
 {
-  int idx_size = idx.size();
-  int end = idx_size - 1;
+  return model_.calcCOMAcceleration(state_);
+}
 
-  Eigen::MatrixXd tar_position = op3_link_data_[idx[end]]->position_;
-  Eigen::MatrixXd jacobian = Eigen::MatrixXd::Zero(6, idx_size);
+bool OP3KinematicsDynamics::calcZMP(double ground_height, Eigen::Vector3d &zmp)
+{
+  return model_.calcZMP(state_, ground_height, zmp);
+}
 
-  for (int id = 0; id < idx_size; id++)
-  {
-    int curr_id = idx[id];
+void OP3KinematicsDynamics::calcSupportPolygon(SupportPhase phase, double foot_size_x, double foot_size_y,
+                                               SupportPolygon &polygon)
+{
+  model_.calcSupportPolygon(state_, phase, foot_size_x, foot_size_y, polygon);
+}
 
-    Eigen::MatrixXd tar_orientation = op3_link_data_[curr_id]->orientation_ * op3_link_data_[curr_id]->joint_axis_;
+double OP3KinematicsDynamics::calcCOMMargin(const SupportPolygon &polygon)
+{
+  return model_.calcCOMMargin(state_, polygon);
+}
 
-    jacobian.block(0, id, 3, 1) = robotis_framework::calcCross(tar_orientation,
-                                                               tar_position - op3_link_data_[curr_id]->position_);
-    jacobian.block(3, id, 3, 1) = tar_orientation;
-  }
+bool OP3KinematicsDynamics::calcZMPMargin(const SupportPolygon &polygon, double ground_height, double &margin)
+{
+  return model_.calcZMPMargin(state_, polygon, ground_height, margin);
+}
 
-  return jacobian;
+void OP3KinematicsDynamics::calcInverseDynamics(double *torque)
+{
+  pullJointState();
+  model_.calcInverseDynamics(state_, torque);
+  pushKinematics();
 }
 
-Eigen::MatrixXd OP3KinematicsDynamics::calcJacobianCOM(std::vector<int> idx)
+void OP3KinematicsDynamics::calcGravityTorque(double *torque)
 {
-  int idx_size = idx.size();
-  int end = idx_size - 1;
+  pullJointState();
+  model_.calcGravityTorque(state_, torque);
+  pushKinematics();
+}
 
-  Eigen::MatrixXd tar_position = op3_link_data_[idx[end]]->position_;
-  Eigen::MatrixXd jacobian_com = Eigen::MatrixXd::Zero(6, idx_size);
+void OP3KinematicsDynamics::calcMassMatrix(JointSpaceMatrix &mass_matrix)
+{
+  pullJointState();
+  model_.calcMassMatrix(state_, mass_matrix);
+  pushKinematics();
+}
 
-  for (int id = 0; id < idx_size; id++)
-  {
-    int curr_id = idx[id];
-    double mass = calcTotalMass(curr_id);
+void OP3KinematicsDynamics::calcCentroidalMomentumMatrix(CentroidalMomentumMatrix &momentum_matrix)
+{
+  pullJointState();
+  model_.calcCentroidalMomentumMatrix(state_, momentum_matrix);
+  pushKinematics();
+}
 
-    Eigen::MatrixXd og = calcMC(curr_id) / mass - op3_link_data_[curr_id]->position_;
-    Eigen::MatrixXd tar_orientation = op3_link_data_[curr_id]->orientation_ * op3_link_data_[curr_id]->joint_axis_;
+Eigen::MatrixXd OP3KinematicsDynamics::calcJacobian(std::vector<int> idx)
+{
+  return calcJacobian(JointRoute(idx));
+}
 
-    jacobian_com.block(0, id, 3, 1) = robotis_framework::calcCross(tar_orientation, og);
-    jacobian_com.block(3, id, 3, 1) = tar_orientation;
-  }
+Eigen::MatrixXd OP3KinematicsDynamics::calcJacobian(const JointRoute &idx)
+{
+  IKJacobian jacobian;
+  model_.calcJacobian(state_, idx, jacobian);
+
+  return jacobian;
+}
+
+Eigen::MatrixXd OP3KinematicsDynamics::calcJacobianCOM(std::vector<int> idx)
+{
+  return calcJacobianCOM(JointRoute(idx));
+}
+
+Eigen::MatrixXd OP3KinematicsDynamics::calcJacobianCOM(const JointRoute &idx)
+{
+  IKJacobian jacobian_com;
+  model_.calcJacobianCOM(state_, idx, jacobian_com);
 
   return jacobian_com;
 }
@@ -656,13 +285,7 @@ Eigen::MatrixXd OP3KinematicsDynamics::calcJacobianCOM(std::vector<int> idx)
 Eigen::MatrixXd OP3KinematicsDynamics::calcVWerr(Eigen::MatrixXd tar_position, Eigen::MatrixXd curr_position,
                                                  Eigen::MatrixXd tar_orientation, Eigen::MatrixXd curr_orientation)
 {
-  Eigen::MatrixXd pos_err = tar_position - curr_position;
-  Eigen::MatrixXd ori_err = curr_orientation.transpose() * tar_orientation;
-  Eigen::MatrixXd ori_err_dash = curr_orientation * robotis_framework::convertRotToOmega(ori_err);
-
-  Eigen::MatrixXd err = Eigen::MatrixXd::Zero(6, 1);
-  err.block<3, 1>(0, 0) = pos_err;
-  err.block<3, 1>(3, 0) = ori_err_dash;
+  Eigen::MatrixXd err = model_.calcPoseError(tar_position, curr_position, tar_orientation, curr_orientation);
 
   return err;
 }
@@ -670,459 +293,168 @@ Eigen::MatrixXd OP3KinematicsDynamics::calcVWerr(Eigen::MatrixXd tar_position, E
 bool OP3KinematicsDynamics::calcInverseKinematics(int to, Eigen::MatrixXd tar_position, Eigen::MatrixXd tar_orientation,
                                                   int max_iter, double ik_err)
 {
-  bool ik_success = false;
-  bool limit_success = false;
-
-  //  calcForwardKinematics(0);
-
-  std::vector<int> idx = findRoute(to);
-
-  for (int iter = 0; iter < max_iter; iter++)
-  {
-    Eigen::MatrixXd jacobian = calcJacobian(idx);
-
-    Eigen::MatrixXd curr_position = op3_link_data_[to]->position_;
-    Eigen::MatrixXd curr_orientation = op3_link_data_[to]->orientation_;
-
-    Eigen::MatrixXd err = calcVWerr(tar_position, curr_position, tar_orientation, curr_orientation);
-
-    if (err.norm() < ik_err)
-    {
-      ik_success = true;
-      break;
-    }
-    else
-      ik_success = false;
-
-    Eigen::MatrixXd jacobian_trans = jacobian * jacobian.transpose();
-    Eigen::MatrixXd jacobian_inverse = jacobian.transpose() * jacobian_trans.inverse();
-
-    Eigen::MatrixXd delta_angle = jacobian_inverse * err;
-
-    for (int id = 0; id < idx.size(); id++)
-    {
-      int joint_num = idx[id];
-      op3_link_data_[joint_num]->joint_angle_ += delta_angle.coeff(id);
-    }
-
-    calcForwardKinematics(0);
-  }
-
-  for (int id = 0; id < idx.size(); id++)
-  {
-    int joint_num = idx[id];
-
-    if (op3_link_data_[joint_num]->joint_angle_ >= op3_link_data_[joint_num]->joint_limit_max_)
-    {
-      limit_success = false;
-      break;
-    }
-    else if (op3_link_data_[joint_num]->joint_angle_ <= op3_link_data_[joint_num]->joint_limit_min_)
-    {
-      limit_success = false;
-      break;
-    }
-    else
-      limit_success = true;
-  }
-
-  if (ik_success == true && limit_success == true)
-    return true;
-  else
-    return false;
+  return calcRouteInverseKinematics(getRoute(to), to, tar_position, tar_orientation, max_iter, ik_err, NULL);
 }
 
 bool OP3KinematicsDynamics::calcInverseKinematics(int from, int to, Eigen::MatrixXd tar_position,
                                                   Eigen::MatrixXd tar_orientation, int max_iter, double ik_err)
 {
-  bool ik_success = false;
-  bool limit_success = false;
-
-  //  calcForwardKinematics(0);
-
-  std::vector<int> idx = findRoute(from, to);
-
-  for (int iter = 0; iter < max_iter; iter++)
-  {
-    Eigen::MatrixXd jacobian = calcJacobian(idx);
-
-    Eigen::MatrixXd curr_position = op3_link_data_[to]->position_;
-    Eigen::MatrixXd curr_orientation = op3_link_data_[to]->orientation_;
-
-    Eigen::MatrixXd err = calcVWerr(tar_position, curr_position, tar_orientation, curr_orientation);
-
-    if (err.norm() < ik_err)
-    {
-      ik_success = true;
-      break;
-    }
-    else
-      ik_success = false;
-
-    Eigen::MatrixXd jacobian_trans = jacobian * jacobian.transpose();
-    Eigen::MatrixXd jacobian_inv = jacobian.transpose() * jacobian_trans.inverse();
-
-    Eigen::MatrixXd delta_angle = jacobian_inv * err;
-
-    for (int id = 0; id < idx.size(); id++)
-    {
-      int joint_num = idx[id];
-      op3_link_data_[joint_num]->joint_angle_ += delta_angle.coeff(id);
-    }
-
-    calcForwardKinematics(0);
-  }
-
-  for (int id = 0; id < idx.size(); id++)
-  {
-    int joint_num = idx[id];
-
-    if (op3_link_data_[joint_num]->joint_angle_ >= op3_link_data_[joint_num]->joint_limit_max_)
-    {
-      limit_success = false;
-      break;
-    }
-    else if (op3_link_data_[joint_num]->joint_angle_ <= op3_link_data_[joint_num]->joint_limit_min_)
-    {
-      limit_success = false;
-      break;
-    }
-    else
-      limit_success = true;
-  }
-
-  if (ik_success == true && limit_success == true)
-    return true;
-  else
-    return false;
+  return calcRouteInverseKinematics(getRoute(from, to), to, tar_position, tar_orientation, max_iter, ik_err, NULL);
 }
 
 bool OP3KinematicsDynamics::calcInverseKinematics(int to, Eigen::MatrixXd tar_position, Eigen::MatrixXd tar_orientation,
                                                   int max_iter, double ik_err, Eigen::MatrixXd weight)
 {
-  bool ik_success = false;
-  bool limit_success = false;
-
-  //  calcForwardKinematics(0);
-
-  std::vector<int> idx = findRoute(to);
-
-  /* weight */
-  Eigen::MatrixXd weight_matrix = Eigen::MatrixXd::Identity(idx.size(), idx.size());
-
-  for (int ix = 0; ix < idx.size(); ix++)
-    weight_matrix.coeffRef(ix, ix) = weight.coeff(idx[ix], 0);
-
-  /* damping */
-  Eigen::MatrixXd eval = Eigen::MatrixXd::Zero(6, 6);
-
-  double p_damping = 1e-5;
-  double R_damping = 1e-5;
-
-  for (int ix = 0; ix < 3; ix++)
-  {
-    eval.coeffRef(ix, ix) = p_damping;
-    eval.coeffRef(ix + 3, ix + 3) = R_damping;
-  }
-
-  /* ik */
-  for (int iter = 0; iter < max_iter; iter++)
-  {
-    Eigen::MatrixXd jacobian = calcJacobian(idx);
-
-    Eigen::MatrixXd curr_position = op3_link_data_[to]->position_;
-    Eigen::MatrixXd curr_orientation = op3_link_data_[to]->orientation_;
-
-    Eigen::MatrixXd err = calcVWerr(tar_position, curr_position, tar_orientation, curr_orientation);
-
-    if (err.norm() < ik_err)
-    {
-      ik_success = true;
-      break;
-    }
-    else
-      ik_success = false;
-
-    Eigen::MatrixXd jacobian_trans = (jacobian * weight_matrix * jacobian.transpose() + eval);
-    Eigen::MatrixXd jacobian_inv = weight_matrix * jacobian.transpose() * jacobian_trans.inverse();
-
-    Eigen::MatrixXd delta_angle = jacobian_inv * err;
-
-    for (int id = 0; id < idx.size(); id++)
-    {
-      int joint_id = idx[id];
-      op3_link_data_[joint_id]->joint_angle_ += delta_angle.coeff(id);
-    }
-
-    calcForwardKinematics(0);
-  }
-
-  /* check joint limit */
-  for (int id = 0; id < idx.size(); id++)
-  {
-    int joint_num = idx[id];
-
-    if (op3_link_data_[joint_num]->joint_angle_ >= op3_link_data_[joint_num]->joint_limit_max_)
-    {
-      limit_success = false;
-      break;
-    }
-    else if (op3_link_data_[joint_num]->joint_angle_ <= op3_link_data_[joint_num]->joint_limit_min_)
-    {
-      limit_success = false;
-      break;
-    }
-    else
-      limit_success = true;
-  }
-
-  if (ik_success == true && limit_success == true)
-    return true;
-  else
-    return false;
+  return calcRouteInverseKinematics(getRoute(to), to, tar_position, tar_orientation, max_iter, ik_err, &weight);
 }
 
 bool OP3KinematicsDynamics::calcInverseKinematics(int from, int to, Eigen::MatrixXd tar_position,
                                                   Eigen::MatrixXd tar_orientation, int max_iter, double ik_err,
                                                   Eigen::MatrixXd weight)
 {
-  bool ik_success = false;
-  bool limit_success = false;
-
-  //  calcForwardKinematics(0);
-
-  std::vector<int> idx = findRoute(from, to);
+  return calcRouteInverseKinematics(getRoute(from, to), to, tar_position, tar_orientation, max_iter, ik_err,
+                                    &weight);
+}
 
-  /* weight */
-  Eigen::MatrixXd weight_matrix = Eigen::MatrixXd::Identity(idx.size(), idx.size());
+bool OP3KinematicsDynamics::calcRouteInverseKinematics(const JointRoute &idx, int to,
+                                                       const Eigen::Vector3d &tar_position,
+                                                       const Eigen::Matrix3d &tar_orientation, int max_iter,
+                                                       double ik_err, const Eigen::MatrixXd *weight)
+{
+  pullJointState();
+  bool result = model_.calcInverseKinematics(state_, idx, to, tar_position, tar_orientation, max_iter, ik_err,
+                                             weight);
+  pushKinematics();
 
-  for (int ix = 0; ix < idx.size(); ix++)
-    weight_matrix.coeffRef(ix, ix) = weight.coeff(idx[ix], 0);
+  return result;
+}
 
-  /* damping */
-  Eigen::MatrixXd eval = Eigen::MatrixXd::Zero(6, 6);
+template<typename IKPolicy>
+bool OP3KinematicsDynamics::solveInverseKinematics(const JointRoute &idx, int to,
+                                                   const Eigen::Vector3d &tar_position,
+                                                   const Eigen::Matrix3d &tar_orientation, int max_iter,
+                                                   double ik_err, const IKPolicy &policy)
+{
+  pullJointState();
+  bool result = model_.solveInverseKinematics(state_, idx, to, tar_position, tar_orientation, max_iter, ik_err,
+                                              policy);
+  pushKinematics();
 
-  double p_damping = 1e-5;
-  double R_damping = 1e-5;
+  return result;
+}
 
-  for (int ix = 0; ix < 3; ix++)
-  {
-    eval.coeffRef(ix, ix) = p_damping;
-    eval.coeffRef(ix + 3, ix + 3) = R_damping;
-  }
+template bool OP3KinematicsDynamics::solveInverseKinematics<PseudoInverseIKPolicy>(
+    const JointRoute &idx, int to, const Eigen::Vector3d &tar_position, const Eigen::Matrix3d &tar_orientation,
+    int max_iter, double ik_err, const PseudoInverseIKPolicy &policy);
+template bool OP3KinematicsDynamics::solveInverseKinematics<WeightedDampedIKPolicy>(
+    const JointRoute &idx, int to, const Eigen::Vector3d &tar_position, const Eigen::Matrix3d &tar_orientation,
+    int max_iter, double ik_err, const WeightedDampedIKPolicy &policy);
+template bool OP3KinematicsDynamics::solveInverseKinematics<LevenbergMarquardtIKPolicy>(
+    const JointRoute &idx, int to, const Eigen::Vector3d &tar_position, const Eigen::Matrix3d &tar_orientation,
+    int max_iter, double ik_err, const LevenbergMarquardtIKPolicy &policy);
+
+bool OP3KinematicsDynamics::calcDifferentialInverseKinematics(const JointRoute &idx, int to,
+                                                              const Eigen::Vector3d &tar_position,
+                                                              const Eigen::Matrix3d &tar_orientation, double ik_err,
+                                                              const DifferentialIKOption &option)
+{
+  pullJointState();
+  bool result = model_.calcDifferentialInverseKinematics(state_, idx, to, tar_position, tar_orientation, ik_err,
+                                                         option);
+  pushKinematics();
 
-  /* ik */
-  for (int iter = 0; iter < max_iter; iter++)
-  {
-    Eigen::MatrixXd jacobian = calcJacobian(idx);
-    Eigen::MatrixXd curr_position = op3_link_data_[to]->position_;
-    Eigen::MatrixXd curr_orientation = op3_link_data_[to]->orientation_;
-    Eigen::MatrixXd err = calcVWerr(tar_position, curr_position, tar_orientation, curr_orientation);
+  return result;
+}
 
-    if (err.norm() < ik_err)
-    {
-      ik_success = true;
-      break;
-    }
-    else
-      ik_success = false;
+bool OP3KinematicsDynamics::calcWholeBodyInverseKinematics(const WholeBodyIKProblem &problem, int max_iter,
+                                                           double ik_err)
+{
+  pullJointState();
+  bool result = model_.calcWholeBodyInverseKinematics(state_, problem, max_iter, ik_err);
+  pushKinematics();
 
-    Eigen::MatrixXd jacobian_trans = (jacobian * weight_matrix * jacobian.transpose() + eval);
-    Eigen::MatrixXd jacobian_inv = weight_matrix * jacobian.transpose() * jacobian_trans.inverse();
-    Eigen::MatrixXd delta_angle = jacobian_inv * err;
+  return result;
+}
 
-    for (int id = 0; id < idx.size(); id++)
-    {
-      int joint_id = idx[id];
-      op3_link_data_[joint_id]->joint_angle_ += delta_angle.coeff(id);
-    }
-    calcForwardKinematics(0);
-  }
+const InverseKinematicsResult &OP3KinematicsDynamics::getInverseKinematicsResult() const
+{
+  return state_.ik_result_;
+}
 
-  /* check joint limit */
-  for (int id = 0; id < idx.size(); id++)
-  {
-    int _joint_num = idx[id];
-    if (op3_link_data_[_joint_num]->joint_angle_ >= op3_link_data_[_joint_num]->joint_limit_max_)
-    {
-      limit_success = false;
-      break;
-    }
-    else if (op3_link_data_[_joint_num]->joint_angle_ <= op3_link_data_[_joint_num]->joint_limit_min_)
-    {
-      limit_success = false;
-      break;
-    }
-    else
-      limit_success = true;
-  }
+void OP3KinematicsDynamics::setInverseKinematicsOption(const InverseKinematicsOption &option)
+{
+  state_.ik_option_ = option;
+}
 
-  if (ik_success == true && limit_success == true)
-    return true;
-  else
-    return false;
+const InverseKinematicsOption &OP3KinematicsDynamics::getInverseKinematicsOption() const
+{
+  return state_.ik_option_;
 }
 
 bool OP3KinematicsDynamics::calcInverseKinematicsForLeg(double *out, double x, double y, double z, double roll,
                                                         double pitch, double yaw)
 {
-  Eigen::Matrix3d R06 = robotis_framework::convertRPYToRotation(roll, pitch, yaw);
-  Eigen::Vector3d p06 = robotis_framework::getTransitionXYZ(x, y, z) + ankle_length_m_*R06.block<3,1>(0,2); //desired hip to ankle
-  
-  //calc q6
-  Eigen::Vector3d p60 = -R06.transpose()*p06;
-  *(out + 5) = atan2(p60(1), p60(2));
-
-  //calc q1
-  Eigen::Matrix3d R05 = R06*robotis_framework::getRotationX(-(*(out + 5)));
-  *(out + 0) = atan2(-R05(0, 1), R05(1, 1));
-
-  //calc q4
-  Eigen::Vector3d p03 = robotis_framework::getRotationZ(*(out + 0))*robotis_framework::getTransitionXYZ(hip_pitch_offset_m_, 0, 0);
-  Eigen::Vector3d p36 = p06 - p03;
-  
-  *(out + 3) = -acos((thigh_length_m_*thigh_length_m_ + calf_length_m_*calf_length_m_ - p36.norm()*p36.norm())/(2*thigh_length_m_*calf_length_m_)) + EIGEN_PI;
-
-  //calc q5
-  double alpha = asin(thigh_length_m_*sin(EIGEN_PI - *(out + 3))/p36.norm());
-  Eigen::Vector3d p63 = -R06.transpose()*p36;
-  *(out + 4) = -atan2(p63(0), getSign(p63(2))*sqrt(p63(1)*p63(1) + p63(2)*p63(2))) - alpha;
-
-  //calc q2 and q3
-  Eigen::Matrix3d R13 = robotis_framework::getRotationZ(-(*(out + 0))) * R05 * robotis_framework::getRotationY( -(*(out + 4) + *(out + 3)) );
-  *(out + 1) = atan2(R13(2,1), R13(1,1));
-  *(out + 2) = atan2(R13(0,2), R13(0,0));
-  
-  *(out + 2) += hip_offset_angle_rad_;
-  *(out + 3) += -hip_offset_angle_rad_;
-
-  // Eigen::Matrix4d trans_ad, trans_da, trans_cd, trans_dc, trans_ac;
-  // Eigen::Vector3d vec;
-
-  // bool invertible;
-  // double rac, arc_cos, arc_tan, k, l, m, n, s, c, theta;
-  // double thigh_length = thigh_length_m_;
-  // double calf_length = calf_length_m_;
-  // double ankle_length = ankle_length_m_;
-
-  // trans_ad = robotis_framework::getTransformationXYZRPY(x, y, z, roll, pitch, yaw);
-
-  // vec.coeffRef(0) = trans_ad.coeff(0, 3) + trans_ad.coeff(0, 2) * ankle_length;
-  // vec.coeffRef(1) = trans_ad.coeff(1, 3) + trans_ad.coeff(1, 2) * ankle_length;
-  // vec.coeffRef(2) = trans_ad.coeff(2, 3) + trans_ad.coeff(2, 2) * ankle_length;
-
-  // // Get Knee
-  // rac = vec.norm();
-  // arc_cos = acos(
-  //     (rac * rac - thigh_length * thigh_length - calf_length * calf_length) / (2.0 * thigh_length * calf_length));
-  // if (std::isnan(arc_cos) == 1)
-  //   return false;
-  // *(out + 3) = arc_cos;
-
-  // // Get Ankle Roll
-  // trans_ad.computeInverseWithCheck(trans_da, invertible);
-  // if (invertible == false)
-  //   return false;
-
-  // k = sqrt(trans_da.coeff(1, 3) * trans_da.coeff(1, 3) + trans_da.coeff(2, 3) * trans_da.coeff(2, 3));
-  // l = sqrt(
-  //     trans_da.coeff(1, 3) * trans_da.coeff(1, 3)
-  //         + (trans_da.coeff(2, 3) - ankle_length) * (trans_da.coeff(2, 3) - ankle_length));
-  // m = (k * k - l * l - ankle_length * ankle_length) / (2.0 * l * ankle_length);
-
-  // if (m > 1.0)
-  //   m = 1.0;
-  // else if (m < -1.0)
-  //   m = -1.0;
-  // arc_cos = acos(m);
-
-  // if (std::isnan(arc_cos) == 1)
-  //   return false;
-
-  // if (trans_da.coeff(1, 3) < 0.0)
-  //   *(out + 5) = -arc_cos;
-  // else
-  //   *(out + 5) = arc_cos;
-
-  // // Get Hip Yaw
-  // trans_cd = robotis_framework::getTransformationXYZRPY(0, 0, -ankle_length, *(out + 5), 0, 0);
-  // trans_cd.computeInverseWithCheck(trans_dc, invertible);
-  // if (invertible == false)
-  //   return false;
-
-  // trans_ac = trans_ad * trans_dc;
-  // arc_tan = atan2(-trans_ac.coeff(0, 1), trans_ac.coeff(1, 1));
-  // if (std::isinf(arc_tan) != 0)
-  //   return false;
-  // *(out) = arc_tan;
-
-  // // Get Hip Roll
-  // arc_tan = atan2(trans_ac.coeff(2, 1), -trans_ac.coeff(0, 1) * sin(*(out)) + trans_ac.coeff(1, 1) * cos(*(out)));
-  // if (std::isinf(arc_tan) != 0)
-  //   return false;
-  // *(out + 1) = arc_tan;
-
-  // // Get Hip Pitch and Ankle Pitch
-  // arc_tan = atan2(trans_ac.coeff(0, 2) * cos(*(out)) + trans_ac.coeff(1, 2) * sin(*(out)),
-  //                 trans_ac.coeff(0, 0) * cos(*(out)) + trans_ac.coeff(1, 0) * sin(*(out)));
-  // if (std::isinf(arc_tan) == 1)
-  //   return false;
-  // theta = arc_tan;
-  // k = sin(*(out + 3)) * calf_length;
-  // l = -thigh_length - cos(*(out + 3)) * calf_length;
-  // m = cos(*(out)) * vec.coeff(0) + sin(*(out)) * vec.coeff(1);
-  // n = cos(*(out + 1)) * vec.coeff(2) + sin(*(out)) * sin(*(out + 1)) * vec.coeff(0)
-  //     - cos(*(out)) * sin(*(out + 1)) * vec.coeff(1);
-  // s = (k * n + l * m) / (k * k + l * l);
-  // c = (n - k * s) / l;
-  // arc_tan = atan2(s, c);
-  // if (std::isinf(arc_tan) == 1)
-  //   return false;
-  // *(out + 2) = arc_tan;
-  // *(out + 4) = theta - *(out + 3) - *(out + 2);
-
-  return true;
+  return model_.calcInverseKinematicsForLeg(out, x, y, z, roll, pitch, yaw);
 }
 
 bool OP3KinematicsDynamics::calcInverseKinematicsForRightLeg(double *out, double x, double y, double z, double roll,
                                                              double pitch, double yaw)
 {
-  if (calcInverseKinematicsForLeg(out, x, y, z, roll, pitch, yaw) == true)
-  {
-    for(int ix = 0 ; ix < 6; ix++)
-      out[ix] *= getJointDirection(ID_R_LEG_START + 2 * ix);
-
-    return true;
-  }
-  else
-    return false;
+  return model_.calcInverseKinematicsForRightLeg(out, x, y, z, roll, pitch, yaw);
 }
 
 bool OP3KinematicsDynamics::calcInverseKinematicsForLeftLeg(double *out, double x, double y, double z, double roll,
                                                             double pitch, double yaw)
 {
-  if (calcInverseKinematicsForLeg(out, x, y, z, roll, pitch, yaw) == true)
-  {
-    for(int ix = 0 ; ix < 6; ix++)
-      out[ix] *= getJointDirection(ID_L_LEG_START + 2 * ix);
+  return model_.calcInverseKinematicsForLeftLeg(out, x, y, z, roll, pitch, yaw);
+}
 
-    return true;
-  }
-  else
-    return false;
+int OP3KinematicsDynamics::calcInverseKinematicsForRightLeg(const LegPoseArray &pose, LegJointArray &out, int count)
+{
+  return model_.calcInverseKinematicsForRightLeg(pose, out, count);
+}
+
+int OP3KinematicsDynamics::calcInverseKinematicsForLeftLeg(const LegPoseArray &pose, LegJointArray &out, int count)
+{
+  return model_.calcInverseKinematicsForLeftLeg(pose, out, count);
+}
+
+LegIKParameter OP3KinematicsDynamics::getLegIKParameter(int leg_start_id)
+{
+  return model_.getLegIKParameter(leg_start_id);
+}
+
+int OP3KinematicsDynamics::calcInverseKinematicsForArm(int arm_start_id, double x, double y, double z,
+                                                       ArmIKSolution &solution)
+{
+  return model_.calcInverseKinematicsForArm(arm_start_id, Eigen::Vector3d(x, y, z), solution);
+}
+
+bool OP3KinematicsDynamics::calcInverseKinematicsForRightArm(double *out, double x, double y, double z)
+{
+  double curr_angle[MAX_ARM_ID];
+  for (int ix = 0; ix < MAX_ARM_ID; ix++)
+    curr_angle[ix] = op3_link_data_[ID_R_ARM_START + 2 * ix]->joint_angle_;
+
+  return model_.calcInverseKinematicsForArm(out, ID_R_ARM_START, Eigen::Vector3d(x, y, z), curr_angle);
+}
+
+bool OP3KinematicsDynamics::calcInverseKinematicsForLeftArm(double *out, double x, double y, double z)
+{
+  double curr_angle[MAX_ARM_ID];
+  for (int ix = 0; ix < MAX_ARM_ID; ix++)
+    curr_angle[ix] = op3_link_data_[ID_L_ARM_START + 2 * ix]->joint_angle_;
+
+  return model_.calcInverseKinematicsForArm(out, ID_L_ARM_START, Eigen::Vector3d(x, y, z), curr_angle);
 }
 
 LinkData *OP3KinematicsDynamics::getLinkData(const std::string link_name)
 {
-  for (int ix = 0; ix <= ALL_JOINT_ID; ix++)
-  {
-    if (op3_link_data_[ix]->name_ == link_name)
-    {
-      return op3_link_data_[ix];
-    }
-  }
+  int link_id = model_.getLinkId(link_name);
+  if (link_id == -1)
+    return NULL;
 
-  return NULL;
+  return op3_link_data_[link_id];
 }
 
 LinkData *OP3KinematicsDynamics::getLinkData(const int link_id)
@@ -1177,72 +509,96 @@ double OP3KinematicsDynamics::getJointDirection(const int link_id)
   return joint_direction;
 }
 
+void OP3KinematicsDynamics::resetPreviewParamCache()
+{
+  for (int ix = 0; ix < PREVIEW_PARAM_CACHE_SIZE; ix++)
+    preview_param_cache_[ix].valid = false;
+  preview_param_cache_next_ = 0;
+}
+
 Eigen::MatrixXd OP3KinematicsDynamics::calcPreviewParam(double preview_time, double control_cycle,
                                                         double lipm_height,
                                                         Eigen::MatrixXd K, Eigen::MatrixXd P)
 {
+  if (K.rows() != 1 || K.cols() != 4 || P.rows() != 4 || P.cols() != 4)
+    return Eigen::MatrixXd();
+
+  for (int ix = 0; ix < PREVIEW_PARAM_CACHE_SIZE; ix++)
+  {
+    const PreviewParamCache &cache = preview_param_cache_[ix];
+    if (cache.valid == false || cache.preview_time != preview_time || cache.control_cycle != control_cycle
+        || cache.lipm_height != lipm_height)
+      continue;
+
+    bool same = true;
+    for (int i = 0; i < 4 && same; i++)
+      same = (cache.K[i] == K.coeff(0, i));
+    for (int i = 0; i < 16 && same; i++)
+      same = (cache.P[i] == P.coeff(i % 4, i / 4));
+
+    if (same)
+      return cache.f;
+  }
+
   double t = control_cycle;
-  double preview_size_ = round(preview_time/control_cycle) + 1;
+  int preview_size = round(preview_time/control_cycle) + 1;
 
-  Eigen::MatrixXd A_;
-  A_.resize(3,3);
-  A_ << 1,  t,  t*t/2.0,
-        0,  1,  t,
-        0,  0,  1;
+  Eigen::Matrix3d A;
+  A << 1,  t,  t*t/2.0,
+       0,  1,  t,
+       0,  0,  1;
 
-  Eigen::MatrixXd b_;
-  b_.resize(3,1);
-  b_ << t*t*t/6.0,
-        t*t/2.0,
-        t;
+  Eigen::Vector3d b;
+  b << t*t*t/6.0,
+       t*t/2.0,
+       t;
 
-  Eigen::MatrixXd c_;
-  c_.resize(1,3);
-  c_ << 1, 0, -lipm_height/9.81;
+  Eigen::RowVector3d c;
+  c << 1, 0, -lipm_height/9.81;
 
-  Eigen::MatrixXd tempA = Eigen::MatrixXd::Zero(4,4);
-  Eigen::MatrixXd tempb = Eigen::MatrixXd::Zero(4,1);
-  Eigen::MatrixXd tempc = Eigen::MatrixXd::Zero(1,4);
+  // augmented with the integral of the zmp error
+  Eigen::Matrix4d tempA = Eigen::Matrix4d::Zero();
+  Eigen::Vector4d tempb;
 
   tempA.coeffRef(0,0) = 1;
-  tempA.block<1,3>(0,1) = c_*A_;
-  tempA.block<3,3>(1,1) = A_;
-
-  tempb.coeffRef(0,0) = (c_*b_).coeff(0,0);
-  tempb.block<3,1>(1,0) = b_;
+  tempA.block<1,3>(0,1) = c*A;
+  tempA.block<3,3>(1,1) = A;
 
-  tempc.coeffRef(0,0) = 1;
+  tempb.coeffRef(0) = c.dot(b);
+  tempb.segment<3>(1) = b;
 
   double R = 1e-6;
-  double Q_e = 1;
-  double Q_x = 0;
 
-  Eigen::MatrixXd Q = Eigen::MatrixXd::Zero(4,4);
-  Q.coeffRef(0,0) = Q_e;
-  Q.coeffRef(1,1) = Q_e;
-  Q.coeffRef(2,2) = Q_e;
-  Q.coeffRef(3,3) = Q_x;
+  Eigen::Matrix4d fixed_P = P;
+  Eigen::RowVector4d fixed_K = K;
 
-  Eigen::MatrixXd f_;
-  f_.resize(1, preview_size_);
+  // f_i = (R + b'Pb)^-1 b' ((A - bK)')^i P c', c = [1 0 0 0].
+  // the row vector is carried through the closed loop instead of the matrix power
+  Eigen::RowVector4d gain = tempb.transpose() / (R + tempb.dot(fixed_P * tempb));
+  Eigen::Matrix4d closed_loop = (tempA - tempb*fixed_K).transpose();
+  Eigen::Vector4d Pc = fixed_P.col(0);
 
-  Eigen::MatrixXd mat_R = Eigen::MatrixXd::Zero(1,1);
-  mat_R.coeffRef(0,0) = R;
+  Eigen::MatrixXd f_(1, preview_size);
 
-  Eigen::MatrixXd tempCoeff1 = mat_R + ((tempb.transpose() * P) * tempb);
-  Eigen::MatrixXd tempCoeff1_inv = tempCoeff1.inverse();
-  Eigen::MatrixXd tempCoeff2 = tempb.transpose();
-  Eigen::MatrixXd tempCoeff3 = Eigen::MatrixXd::Identity(4,4);
-  Eigen::MatrixXd tempCoeff4 = P*tempc.transpose();
-
-  f_.block<1,1>(0,0) = ((tempCoeff1_inv*tempCoeff2)* tempCoeff3) * tempCoeff4;
-
-  for(int i = 1; i < preview_size_; i++)
+  for(int i = 0; i < preview_size; i++)
   {
-    tempCoeff3 = tempCoeff3*((tempA - tempb*K).transpose());
-    f_.block<1,1>(0,i) = ((tempCoeff1_inv*tempCoeff2)* tempCoeff3) * tempCoeff4;
+    f_.coeffRef(0,i) = gain.dot(Pc);
+    gain = gain*closed_loop;
   }
 
+  PreviewParamCache &cache = preview_param_cache_[preview_param_cache_next_];
+  preview_param_cache_next_ = (preview_param_cache_next_ + 1) % PREVIEW_PARAM_CACHE_SIZE;
+
+  cache.valid = true;
+  cache.preview_time = preview_time;
+  cache.control_cycle = control_cycle;
+  cache.lipm_height = lipm_height;
+  for (int i = 0; i < 4; i++)
+    cache.K[i] = fixed_K.coeff(i);
+  for (int i = 0; i < 16; i++)
+    cache.P[i] = fixed_P.coeff(i % 4, i / 4);
+  cache.f = f_;
+
   return f_;
 }
 
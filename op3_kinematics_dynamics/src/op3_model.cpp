@@ -0,0 +1,1637 @@
+/*******************************************************************************
+* Copyright 2017 ROBOTIS CO., LTD.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+/* Author: SCH, Jay Song, Kayman */
+
+#include <algorithm>
+#include "op3_kinematics_dynamics/op3_model.h"
+
+namespace robotis_op
+{
+
+double getSign(double num)
+{
+  if(num < 0)
+    return -1.0;
+  else
+    return 1.0;
+}
+
+OP3Model::OP3Model()
+  : link_count_(0),
+    hip_offset_angle_rad_(0.0),
+    hip_pitch_offset_m_(0.0),
+    thigh_length_m_(0.0),
+    calf_length_m_(0.0),
+    ankle_length_m_(0.0)
+{
+  for (int id = 0; id <= ALL_JOINT_ID; id++)
+  {
+    joint_axis_[id].setZero();
+    joint_axis_type_[id] = JointAxisNone;
+    joint_axis_sign_[id] = 0.0;
+    joint_limit_max_[id] = 100.0;
+    joint_limit_min_[id] = -100.0;
+    tree_index_[id] = -1;
+    route_length_[id] = 0;
+  }
+  for (int ix = 0; ix < LINK_NAME_TABLE_SIZE; ix++)
+    link_name_table_[ix] = -1;
+}
+
+OP3Model::OP3Model(LinkData * const *link_data)
+  : link_count_(0)
+{
+  for (int id = 0; id <= ALL_JOINT_ID; id++)
+  {
+    link_name_[id] = link_data[id]->name_;
+    joint_axis_[id] = link_data[id]->joint_axis_;
+    joint_axis_type_[id] = classifyJointAxis(joint_axis_[id], joint_axis_sign_[id]);
+    joint_limit_max_[id] = link_data[id]->joint_limit_max_;
+    joint_limit_min_[id] = link_data[id]->joint_limit_min_;
+    tree_index_[id] = -1;
+  }
+
+  // depth-first order : a link, its children, then its later siblings
+  int stack[ALL_JOINT_ID + 1];
+  int stack_size = 0;
+
+  stack[stack_size++] = 0;
+
+  while (stack_size > 0)
+  {
+    int id = stack[--stack_size];
+    const LinkData *link = link_data[id];
+
+    tree_order_[link_count_] = id;
+    tree_index_[id] = link_count_;
+    tree_mass_[link_count_] = link->mass_;
+    tree_relative_position_[link_count_] = link->relative_position_;
+    tree_joint_axis_[link_count_] = link->joint_axis_;
+    tree_center_of_mass_[link_count_] = link->center_of_mass_;
+    tree_inertia_[link_count_] = link->inertia_;
+    link_count_++;
+
+    if (link->sibling_ != -1)
+      stack[stack_size++] = link->sibling_;
+    if (link->child_ != -1)
+      stack[stack_size++] = link->child_;
+  }
+
+  for (int id = 0; id <= ALL_JOINT_ID; id++)
+    route_length_[id] = 0;
+
+  for (int pos = 0; pos < link_count_; pos++)
+  {
+    const LinkData *link = link_data[tree_order_[pos]];
+    int id = tree_order_[pos];
+    int parent = link->parent_;
+
+    tree_parent_[pos] = (parent == -1) ? -1 : tree_index_[parent];
+    tree_sibling_[pos] = (link->sibling_ == -1) ? -1 : tree_index_[link->sibling_];
+    tree_child_[pos] = (link->child_ == -1) ? -1 : tree_index_[link->child_];
+
+    // the route of a link is the route of its parent followed by the link
+    int length = 0;
+    if (parent != -1)
+    {
+      length = route_length_[parent];
+      for (int ix = 0; ix < length; ix++)
+        route_table_[id][ix] = route_table_[parent][ix];
+    }
+    route_table_[id][length] = id;
+    route_length_[id] = length + 1;
+  }
+
+  // a branch ends where the subtree of its parent ends
+  int subtree_end[ALL_JOINT_ID + 1];
+
+  for (int pos = link_count_ - 1; pos >= 0; pos--)
+  {
+    int child = tree_child_[pos];
+    int sibling = tree_sibling_[pos];
+
+    subtree_end[pos] = (child == -1) ? pos + 1 : tree_branch_end_[child];
+    tree_branch_end_[pos] = (sibling == -1) ? subtree_end[pos] : tree_branch_end_[sibling];
+
+    tree_branch_mass_[pos] = tree_mass_[pos];
+    if (sibling != -1)
+      tree_branch_mass_[pos] += tree_branch_mass_[sibling];
+    if (child != -1)
+      tree_branch_mass_[pos] += tree_branch_mass_[child];
+  }
+
+  for (int ix = 0; ix < LINK_NAME_TABLE_SIZE; ix++)
+    link_name_table_[ix] = -1;
+
+  for (int id = 0; id <= ALL_JOINT_ID; id++)
+  {
+    const std::string &name = link_name_[id];
+    if (name.empty())
+      continue;
+
+    unsigned int slot = hashLinkName(name) % LINK_NAME_TABLE_SIZE;
+    while (link_name_table_[slot] != -1)
+    {
+      // keep the first link of a duplicated name, as the linear search did
+      if (link_name_[link_name_table_[slot]] == name)
+        break;
+      slot = (slot + 1) % LINK_NAME_TABLE_SIZE;
+    }
+
+    if (link_name_table_[slot] == -1)
+      link_name_table_[slot] = id;
+  }
+
+  hip_offset_angle_rad_ = atan2(0.0001, 0.11015);
+  hip_pitch_offset_m_ = 0.0001;
+  thigh_length_m_ = sqrt(link_data[ID_R_LEG_START + 2 * 3]->relative_position_.coeff(0, 0)*link_data[ID_R_LEG_START + 2 * 3]->relative_position_.coeff(0, 0)
+                               + link_data[ID_R_LEG_START + 2 * 3]->relative_position_.coeff(2, 0)*link_data[ID_R_LEG_START + 2 * 3]->relative_position_.coeff(2, 0));
+  calf_length_m_ = std::fabs(link_data[ID_R_LEG_START + 2 * 4]->relative_position_.coeff(2, 0));
+  ankle_length_m_ = std::fabs(link_data[ID_R_LEG_END]->relative_position_.coeff(2, 0));
+}
+
+OP3Model::~OP3Model()
+{
+}
+
+unsigned int OP3Model::hashLinkName(const std::string &link_name)
+{
+  // FNV-1a
+  unsigned int hash = 2166136261u;
+  for (size_t ix = 0; ix < link_name.size(); ix++)
+  {
+    hash ^= static_cast<unsigned char>(link_name[ix]);
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+int OP3Model::getLinkCount() const
+{
+  return link_count_;
+}
+
+int OP3Model::getLinkId(const std::string &link_name) const
+{
+  unsigned int slot = hashLinkName(link_name) % LINK_NAME_TABLE_SIZE;
+
+  while (link_name_table_[slot] != -1)
+  {
+    if (link_name_[link_name_table_[slot]] == link_name)
+      return link_name_table_[slot];
+
+    slot = (slot + 1) % LINK_NAME_TABLE_SIZE;
+  }
+
+  return -1;
+}
+
+const std::string &OP3Model::getLinkName(int link_id) const
+{
+  return link_name_[link_id];
+}
+
+const Eigen::Vector3d &OP3Model::getJointAxis(int link_id) const
+{
+  return joint_axis_[link_id];
+}
+
+double OP3Model::getJointDirection(int link_id) const
+{
+  return joint_axis_[link_id].coeff(0) + joint_axis_[link_id].coeff(1) + joint_axis_[link_id].coeff(2);
+}
+
+double OP3Model::getJointLimitMax(int link_id) const
+{
+  return joint_limit_max_[link_id];
+}
+
+double OP3Model::getJointLimitMin(int link_id) const
+{
+  return joint_limit_min_[link_id];
+}
+
+JointRoute OP3Model::getRoute(int to) const
+{
+  return JointRoute(route_table_[to], route_length_[to]);
+}
+
+JointRoute OP3Model::getRoute(int from, int to) const
+{
+  // the route from an ancestor is the tail of the route from the base
+  int depth = route_length_[from] - 1;
+
+  // if "from" is not an ancestor, the recursive search used to return the route below
+  // the first child of the base. keep that for compatibility
+  if (from == to || depth < 0 || depth >= route_length_[to] || route_table_[to][depth] != from)
+    depth = 2;
+
+  if (depth >= route_length_[to])
+    return JointRoute();
+
+  return JointRoute(route_table_[to] + depth, route_length_[to] - depth);
+}
+
+double OP3Model::calcTotalMass(int joint_id) const
+{
+  if (joint_id == -1 || tree_index_[joint_id] == -1)
+    return 0.0;
+
+  // the link, its later siblings and all of their descendants
+  return tree_branch_mass_[tree_index_[joint_id]];
+}
+
+Eigen::Vector3d OP3Model::calcMC(KinematicsState &state, int joint_id) const
+{
+  if (joint_id == -1 || tree_index_[joint_id] == -1)
+    return Eigen::Vector3d::Zero();
+
+  if (state.branch_mc_valid_ == false)
+    calcBranchMC(state);
+
+  return state.branch_mc_[tree_index_[joint_id]];
+}
+
+Eigen::Vector3d OP3Model::calcCOM(KinematicsState &state) const
+{
+  return calcMC(state, 0) / calcTotalMass(0);
+}
+
+void OP3Model::calcBranchMC(KinematicsState &state) const
+{
+  // children and later siblings come after a link, so one backward pass sums every branch.
+  // the result is kept until the next FK moves a link
+  for (int pos = link_count_ - 1; pos >= 0; pos--)
+  {
+    int id = tree_order_[pos];
+
+    state.branch_mc_[pos] = tree_mass_[pos] * (state.orientation_[id] * tree_center_of_mass_[pos] + state.position_[id]);
+
+    if (tree_sibling_[pos] != -1)
+      state.branch_mc_[pos] += state.branch_mc_[tree_sibling_[pos]];
+    if (tree_child_[pos] != -1)
+      state.branch_mc_[pos] += state.branch_mc_[tree_child_[pos]];
+  }
+
+  state.branch_mc_valid_ = true;
+}
+
+void OP3Model::calcForwardKinematics(KinematicsState &state, int joint_id) const
+{
+  if (joint_id == -1 || tree_index_[joint_id] == -1)
+    return;
+
+  int begin = tree_index_[joint_id];
+  int end = tree_branch_end_[begin];
+
+  // parents come first in the compiled order, so a single forward pass is enough
+  for (int pos = begin; pos < end; pos++)
+    calcLinkKinematics(state, pos);
+}
+
+void OP3Model::updateKinematics(KinematicsState &state) const
+{
+  bool dirty[ALL_JOINT_ID + 1];
+
+  for (int pos = 0; pos < link_count_; pos++)
+  {
+    // NaN never compares equal, so links that were never computed are always dirty
+    dirty[pos] = (state.joint_angle_[tree_order_[pos]] != state.fk_angle_[pos]);
+
+    if (tree_parent_[pos] != -1 && dirty[tree_parent_[pos]] == true)
+      dirty[pos] = true;
+
+    if (dirty[pos] == true)
+      calcLinkKinematics(state, pos);
+  }
+}
+
+bool OP3Model::calcForwardKinematics(const KinematicsState &state, const JointAngleArray &angle,
+                                     LinkPoseArray *link_pose, int link_pose_count, int count,
+                                     int thread_count) const
+{
+  ForwardKinematicsBatchModel model;
+  model.link_count = link_count_;
+
+  for (int pos = 0; pos < link_count_; pos++)
+  {
+    model.link_id[pos] = tree_order_[pos];
+    model.parent[pos] = tree_parent_[pos];
+    model.joint_angle[pos] = state.joint_angle_[tree_order_[pos]];
+
+    for (int ix = 0; ix < 3; ix++)
+    {
+      model.relative_position[pos][ix] = tree_relative_position_[pos].coeff(ix);
+      model.joint_axis[pos][ix] = tree_joint_axis_[pos].coeff(ix);
+    }
+  }
+
+  return calcForwardKinematicsBatch(model, angle, link_pose, link_pose_count, count, thread_count);
+}
+
+void OP3Model::calcForwardKinematicsWithRates(KinematicsState &state) const
+{
+  for (int pos = 0; pos < link_count_; pos++)
+  {
+    calcLinkKinematics(state, pos);
+
+    int id = tree_order_[pos];
+    int parent = tree_parent_[pos];
+
+    Eigen::Vector3d axis = calcWorldJointAxis(id, state.orientation_[id]);
+    Eigen::Vector3d joint_rate = axis * state.joint_velocity_[id];
+
+    if (parent == -1)
+    {
+      state.angular_velocity_[id] = joint_rate;
+      state.angular_acceleration_[id] = axis * state.joint_acceleration_[id];
+      state.linear_velocity_[id].setZero();
+      state.linear_acceleration_[id].setZero();
+      continue;
+    }
+
+    int parent_id = tree_order_[parent];
+    const Eigen::Vector3d &parent_velocity = state.angular_velocity_[parent_id];
+    const Eigen::Vector3d &parent_acceleration = state.angular_acceleration_[parent_id];
+    Eigen::Vector3d offset = state.position_[id] - state.position_[parent_id];
+
+    state.angular_velocity_[id] = parent_velocity + joint_rate;
+    state.angular_acceleration_[id] = parent_acceleration + axis * state.joint_acceleration_[id]
+        + parent_velocity.cross(joint_rate);
+    state.linear_velocity_[id] = state.linear_velocity_[parent_id] + parent_velocity.cross(offset);
+    state.linear_acceleration_[id] = state.linear_acceleration_[parent_id] + parent_acceleration.cross(offset)
+        + parent_velocity.cross(parent_velocity.cross(offset));
+  }
+}
+
+Eigen::Vector3d OP3Model::calcCOMVelocity(const KinematicsState &state) const
+{
+  Eigen::Vector3d momentum = Eigen::Vector3d::Zero();
+
+  for (int pos = 0; pos < link_count_; pos++)
+  {
+    int id = tree_order_[pos];
+    Eigen::Vector3d com = state.orientation_[id] * tree_center_of_mass_[pos];
+
+    momentum += tree_mass_[pos] * (state.linear_velocity_[id] + state.angular_velocity_[id].cross(com));
+  }
+
+  return momentum / tree_branch_mass_[0];
+}
+
+Eigen::Vector3d OP3Model::calcCOMAcceleration(const KinematicsState &state) const
+{
+  Eigen::Vector3d force = Eigen::Vector3d::Zero();
+
+  for (int pos = 0; pos < link_count_; pos++)
+  {
+    int id = tree_order_[pos];
+    const Eigen::Vector3d &velocity = state.angular_velocity_[id];
+    Eigen::Vector3d com = state.orientation_[id] * tree_center_of_mass_[pos];
+
+    force += tree_mass_[pos] * (state.linear_acceleration_[id] + state.angular_acceleration_[id].cross(com)
+        + velocity.cross(velocity.cross(com)));
+  }
+
+  return force / tree_branch_mass_[0];
+}
+
+bool OP3Model::calcZMP(const KinematicsState &state, double ground_height, Eigen::Vector3d &zmp) const
+{
+  const Eigen::Vector3d gravity(0.0, 0.0, -GRAVITY_ACCELERATION);
+
+  // ground reaction force and its moment about the base origin
+  Eigen::Vector3d force = Eigen::Vector3d::Zero();
+  Eigen::Vector3d moment = Eigen::Vector3d::Zero();
+
+  for (int pos = 0; pos < link_count_; pos++)
+  {
+    int id = tree_order_[pos];
+    const Eigen::Matrix3d &orientation = state.orientation_[id];
+    const Eigen::Vector3d &velocity = state.angular_velocity_[id];
+    const Eigen::Vector3d &acceleration = state.angular_acceleration_[id];
+
+    Eigen::Vector3d com = orientation * tree_center_of_mass_[pos];
+    Eigen::Vector3d com_acceleration = state.linear_acceleration_[id] + acceleration.cross(com)
+        + velocity.cross(velocity.cross(com));
+    Eigen::Matrix3d inertia = orientation * tree_inertia_[pos] * orientation.transpose();
+
+    Eigen::Vector3d link_force = tree_mass_[pos] * (com_acceleration - gravity);
+
+    force += link_force;
+    moment += (state.position_[id] + com).cross(link_force) + inertia * acceleration
+        + velocity.cross(inertia * velocity);
+  }
+
+  if (force.coeff(2) < 1e-6)
+    return false;
+
+  // the point on the ground where the horizontal moment vanishes
+  zmp.coeffRef(0) = (ground_height * force.coeff(0) - moment.coeff(1)) / force.coeff(2);
+  zmp.coeffRef(1) = (ground_height * force.coeff(1) + moment.coeff(0)) / force.coeff(2);
+  zmp.coeffRef(2) = ground_height;
+
+  return true;
+}
+
+void OP3Model::calcSupportPolygon(const KinematicsState &state, SupportPhase phase, double foot_size_x,
+                                  double foot_size_y, SupportPolygon &polygon) const
+{
+  polygon.clear();
+
+  if (phase != LeftLegSupport)
+    polygon.addFoot(state.position_[ID_R_LEG_END], state.orientation_[ID_R_LEG_END], foot_size_x, foot_size_y);
+  if (phase != RightLegSupport)
+    polygon.addFoot(state.position_[ID_L_LEG_END], state.orientation_[ID_L_LEG_END], foot_size_x, foot_size_y);
+}
+
+double OP3Model::calcCOMMargin(KinematicsState &state, const SupportPolygon &polygon) const
+{
+  Eigen::Vector3d com = calcCOM(state);
+
+  return polygon.calcMargin(com.coeff(0), com.coeff(1));
+}
+
+bool OP3Model::calcZMPMargin(const KinematicsState &state, const SupportPolygon &polygon, double ground_height,
+                             double &margin) const
+{
+  Eigen::Vector3d zmp;
+  if (calcZMP(state, ground_height, zmp) == false)
+    return false;
+
+  margin = polygon.calcMargin(zmp.coeff(0), zmp.coeff(1));
+  return true;
+}
+
+JointAxisType OP3Model::classifyJointAxis(const Eigen::Vector3d &axis, double &sign)
+{
+  sign = 0.0;
+
+  int nonzero_count = 0;
+  int nonzero_index = 0;
+  for (int ix = 0; ix < 3; ix++)
+  {
+    if (axis.coeff(ix) != 0.0)
+    {
+      nonzero_count++;
+      nonzero_index = ix;
+    }
+  }
+
+  if (nonzero_count == 0)
+    return JointAxisNone;
+
+  // exactly +1 or -1, anything else keeps the general formula so the results do not change
+  double value = axis.coeff(nonzero_index);
+  if (nonzero_count != 1 || (value != 1.0 && value != -1.0))
+    return JointAxisGeneral;
+
+  sign = value;
+  return (nonzero_index == 0) ? JointAxisX : (nonzero_index == 1) ? JointAxisY : JointAxisZ;
+}
+
+void OP3Model::rotateJoint(int link_id, const Eigen::Matrix3d &parent, double joint_angle,
+                           Eigen::Matrix3d &orientation) const
+{
+  JointAxisType axis_type = joint_axis_type_[link_id];
+
+  if (axis_type == JointAxisNone)
+  {
+    orientation = parent;
+    return;
+  }
+  if (axis_type == JointAxisGeneral)
+  {
+    orientation.noalias() = parent
+        * robotis_framework::calcRodrigues(robotis_framework::calcHatto(joint_axis_[link_id]), joint_angle);
+    return;
+  }
+
+  // parent * R only mixes the two columns orthogonal to the axis
+  double s = joint_axis_sign_[link_id] * sin(joint_angle);
+  double c = cos(joint_angle);
+
+  if (axis_type == JointAxisX)
+  {
+    orientation.col(0) = parent.col(0);
+    orientation.col(1) = c * parent.col(1) + s * parent.col(2);
+    orientation.col(2) = c * parent.col(2) - s * parent.col(1);
+  }
+  else if (axis_type == JointAxisY)
+  {
+    orientation.col(0) = c * parent.col(0) - s * parent.col(2);
+    orientation.col(1) = parent.col(1);
+    orientation.col(2) = c * parent.col(2) + s * parent.col(0);
+  }
+  else
+  {
+    orientation.col(0) = c * parent.col(0) + s * parent.col(1);
+    orientation.col(1) = c * parent.col(1) - s * parent.col(0);
+    orientation.col(2) = parent.col(2);
+  }
+}
+
+Eigen::Vector3d OP3Model::calcWorldJointAxis(int link_id, const Eigen::Matrix3d &orientation) const
+{
+  switch (joint_axis_type_[link_id])
+  {
+    case JointAxisNone:
+      return Eigen::Vector3d::Zero();
+    case JointAxisX:
+      return joint_axis_sign_[link_id] * orientation.col(0);
+    case JointAxisY:
+      return joint_axis_sign_[link_id] * orientation.col(1);
+    case JointAxisZ:
+      return joint_axis_sign_[link_id] * orientation.col(2);
+    default:
+      return orientation * joint_axis_[link_id];
+  }
+}
+
+void OP3Model::calcLinkKinematics(KinematicsState &state, int pos) const
+{
+  // fixed-size math only, so a whole-body pass does not touch the heap
+  int id = tree_order_[pos];
+  double joint_angle = state.joint_angle_[id];
+
+  state.fk_angle_[pos] = joint_angle;
+  state.pose_serial_[id]++;
+  state.branch_mc_valid_ = false;
+
+  if (tree_parent_[pos] == -1)
+  {
+    state.position_[id].setZero();
+    rotateJoint(id, Eigen::Matrix3d::Identity(), joint_angle, state.orientation_[id]);
+    return;
+  }
+
+  int parent_id = tree_order_[tree_parent_[pos]];
+
+  state.position_[id].noalias() = state.orientation_[parent_id] * tree_relative_position_[pos];
+  state.position_[id] += state.position_[parent_id];
+  rotateJoint(id, state.orientation_[parent_id], joint_angle, state.orientation_[id]);
+}
+
+void OP3Model::calcInverseDynamics(KinematicsState &state, double *torque) const
+{
+  updateKinematics(state);
+
+  Eigen::Vector3d angular_velocity[ALL_JOINT_ID + 1];
+  Eigen::Vector3d angular_acceleration[ALL_JOINT_ID + 1];
+  Eigen::Vector3d linear_acceleration[ALL_JOINT_ID + 1];  // of the link origin
+  Eigen::Vector3d force[ALL_JOINT_ID + 1];
+  Eigen::Vector3d moment[ALL_JOINT_ID + 1];              // about the link origin
+
+  // everything is expressed in the base frame, so no frame changes are needed between links.
+  // gravity enters as an upward acceleration of the base
+  const Eigen::Vector3d gravity(0.0, 0.0, -GRAVITY_ACCELERATION);
+
+  // forward : link velocities and accelerations, parents first
+  for (int pos = 0; pos < link_count_; pos++)
+  {
+    int id = tree_order_[pos];
+    int parent = tree_parent_[pos];
+
+    Eigen::Vector3d axis = calcWorldJointAxis(id, state.orientation_[id]);
+    Eigen::Vector3d joint_rate = axis * state.joint_velocity_[id];
+
+    if (parent == -1)
+    {
+      angular_velocity[pos] = joint_rate;
+      angular_acceleration[pos] = axis * state.joint_acceleration_[id];
+      linear_acceleration[pos] = -gravity;
+    }
+    else
+    {
+      const Eigen::Vector3d &parent_velocity = angular_velocity[parent];
+      Eigen::Vector3d offset = state.position_[id] - state.position_[tree_order_[parent]];
+
+      angular_velocity[pos] = parent_velocity + joint_rate;
+      angular_acceleration[pos] = angular_acceleration[parent] + axis * state.joint_acceleration_[id]
+          + parent_velocity.cross(joint_rate);
+      linear_acceleration[pos] = linear_acceleration[parent] + angular_acceleration[parent].cross(offset)
+          + parent_velocity.cross(parent_velocity.cross(offset));
+    }
+
+    const Eigen::Vector3d &velocity = angular_velocity[pos];
+    Eigen::Vector3d com = state.orientation_[id] * tree_center_of_mass_[pos];
+    Eigen::Vector3d com_acceleration = linear_acceleration[pos] + angular_acceleration[pos].cross(com)
+        + velocity.cross(velocity.cross(com));
+
+    Eigen::Matrix3d inertia = state.orientation_[id] * tree_inertia_[pos] * state.orientation_[id].transpose();
+
+    force[pos] = tree_mass_[pos] * com_acceleration;
+    moment[pos] = inertia * angular_acceleration[pos] + velocity.cross(inertia * velocity) + com.cross(force[pos]);
+  }
+
+  // backward : each link carries its descendants, children first
+  for (int pos = link_count_ - 1; pos >= 0; pos--)
+  {
+    int id = tree_order_[pos];
+    int parent = tree_parent_[pos];
+
+    torque[id] = calcWorldJointAxis(id, state.orientation_[id]).dot(moment[pos]);
+
+    if (parent == -1)
+      continue;
+
+    force[parent] += force[pos];
+    moment[parent] += moment[pos] + (state.position_[id] - state.position_[tree_order_[parent]]).cross(force[pos]);
+  }
+}
+
+void OP3Model::calcGravityTorque(KinematicsState &state, double *torque) const
+{
+  updateKinematics(state);
+
+  if (state.branch_mc_valid_ == false)
+    calcBranchMC(state);
+
+  const Eigen::Vector3d gravity(0.0, 0.0, -GRAVITY_ACCELERATION);
+
+  // with the links at rest, the moment about a joint is that of the weight of the link and its descendants
+  for (int pos = 0; pos < link_count_; pos++)
+  {
+    int id = tree_order_[pos];
+    int child = tree_child_[pos];
+
+    Eigen::Vector3d mc = tree_mass_[pos] * (state.orientation_[id] * tree_center_of_mass_[pos] + state.position_[id]);
+    double mass = tree_mass_[pos];
+    if (child != -1)
+    {
+      mc += state.branch_mc_[child];
+      mass += tree_branch_mass_[child];
+    }
+
+    Eigen::Vector3d moment = (mc - mass * state.position_[id]).cross(-gravity);
+    torque[id] = calcWorldJointAxis(id, state.orientation_[id]).dot(moment);
+  }
+}
+
+void OP3Model::calcSubtreeMomentum(KinematicsState &state, Eigen::Vector3d *linear, Eigen::Vector3d *angular) const
+{
+  if (state.branch_mc_valid_ == false)
+    calcBranchMC(state);
+
+  // rotational inertia of each branch about the base origin, in the base frame
+  Eigen::Matrix3d branch_inertia[ALL_JOINT_ID + 1];
+
+  for (int pos = link_count_ - 1; pos >= 0; pos--)
+  {
+    int id = tree_order_[pos];
+    int child = tree_child_[pos];
+    const Eigen::Matrix3d &orientation = state.orientation_[id];
+
+    Eigen::Vector3d com = orientation * tree_center_of_mass_[pos] + state.position_[id];
+    Eigen::Matrix3d inertia = orientation * tree_inertia_[pos] * orientation.transpose()
+        + tree_mass_[pos] * (com.squaredNorm() * Eigen::Matrix3d::Identity() - com * com.transpose());
+
+    // the subtree of a link is the link and the branch of its first child
+    Eigen::Vector3d mc = tree_mass_[pos] * com;
+    double mass = tree_mass_[pos];
+    if (child != -1)
+    {
+      inertia += branch_inertia[child];
+      mc += state.branch_mc_[child];
+      mass += tree_branch_mass_[child];
+    }
+
+    // momentum of the subtree turning about the joint at unit rate, the angular part about the base origin
+    const Eigen::Vector3d &position = state.position_[id];
+    Eigen::Vector3d axis = calcWorldJointAxis(id, orientation);
+
+    linear[pos] = axis.cross(mc - mass * position);
+    angular[pos] = inertia * axis - mc.cross(axis.cross(position));
+
+    branch_inertia[pos] = inertia;
+    if (tree_sibling_[pos] != -1)
+      branch_inertia[pos] += branch_inertia[tree_sibling_[pos]];
+  }
+}
+
+void OP3Model::calcMassMatrix(KinematicsState &state, JointSpaceMatrix &mass_matrix) const
+{
+  updateKinematics(state);
+
+  Eigen::Vector3d linear[ALL_JOINT_ID + 1];
+  Eigen::Vector3d angular[ALL_JOINT_ID + 1];
+  calcSubtreeMomentum(state, linear, angular);
+
+  mass_matrix.setZero();
+
+  // a joint only moves its own subtree, so only ancestor pairs couple : M(i, j) = S_i . F_j
+  for (int pos = 0; pos < link_count_; pos++)
+  {
+    int id = tree_order_[pos];
+
+    for (int ix = 0; ix < route_length_[id]; ix++)
+    {
+      int ancestor_id = route_table_[id][ix];
+      const Eigen::Vector3d &position = state.position_[ancestor_id];
+      Eigen::Vector3d axis = calcWorldJointAxis(ancestor_id, state.orientation_[ancestor_id]);
+
+      double inertia = axis.dot(angular[pos]) + position.cross(axis).dot(linear[pos]);
+
+      mass_matrix.coeffRef(ancestor_id, id) = inertia;
+      mass_matrix.coeffRef(id, ancestor_id) = inertia;
+    }
+  }
+}
+
+void OP3Model::calcCentroidalMomentumMatrix(KinematicsState &state,
+                                            CentroidalMomentumMatrix &momentum_matrix) const
+{
+  updateKinematics(state);
+
+  Eigen::Vector3d linear[ALL_JOINT_ID + 1];
+  Eigen::Vector3d angular[ALL_JOINT_ID + 1];
+  calcSubtreeMomentum(state, linear, angular);
+
+  Eigen::Vector3d com = calcCOM(state);
+
+  momentum_matrix.setZero();
+
+  for (int pos = 0; pos < link_count_; pos++)
+  {
+    int id = tree_order_[pos];
+
+    momentum_matrix.block<3, 1>(0, id) = linear[pos];
+    momentum_matrix.block<3, 1>(3, id) = angular[pos] - com.cross(linear[pos]);
+  }
+}
+
+void OP3Model::calcJacobian(const KinematicsState &state, const JointRoute &idx, IKJacobian &jacobian) const
+{
+  int idx_size = idx.size();
+  int end = idx_size - 1;
+
+  const Eigen::Vector3d &tar_position = state.position_[idx[end]];
+  jacobian.resize(6, idx_size);
+
+  for (int id = 0; id < idx_size; id++)
+  {
+    int curr_id = idx[id];
+
+    Eigen::Vector3d tar_orientation = calcWorldJointAxis(curr_id, state.orientation_[curr_id]);
+
+    jacobian.block<3, 1>(0, id) = tar_orientation.cross(tar_position - state.position_[curr_id]);
+    jacobian.block<3, 1>(3, id) = tar_orientation;
+  }
+}
+
+void OP3Model::calcJacobianCOM(KinematicsState &state, const JointRoute &idx, IKJacobian &jacobian) const
+{
+  int idx_size = idx.size();
+
+  jacobian.setZero(6, idx_size);
+
+  if (state.branch_mc_valid_ == false)
+    calcBranchMC(state);
+
+  for (int id = 0; id < idx_size; id++)
+  {
+    int curr_id = idx[id];
+    int pos = tree_index_[curr_id];
+
+    Eigen::Vector3d og = state.branch_mc_[pos] / tree_branch_mass_[pos] - state.position_[curr_id];
+    Eigen::Vector3d tar_orientation = calcWorldJointAxis(curr_id, state.orientation_[curr_id]);
+
+    jacobian.block<3, 1>(0, id) = tar_orientation.cross(og);
+    jacobian.block<3, 1>(3, id) = tar_orientation;
+  }
+}
+
+IKError OP3Model::calcPoseError(const Eigen::Vector3d &tar_position, const Eigen::Vector3d &curr_position,
+                                const Eigen::Matrix3d &tar_orientation,
+                                const Eigen::Matrix3d &curr_orientation) const
+{
+  Eigen::Matrix3d ori_err = curr_orientation.transpose() * tar_orientation;
+
+  IKError err;
+  err.block<3, 1>(0, 0) = tar_position - curr_position;
+  err.block<3, 1>(3, 0) = curr_orientation * robotis_framework::convertRotToOmega(ori_err);
+
+  return err;
+}
+
+bool OP3Model::calcInverseKinematics(KinematicsState &state, const JointRoute &idx, int to,
+                                     const Eigen::Vector3d &tar_position, const Eigen::Matrix3d &tar_orientation,
+                                     int max_iter, double ik_err, const Eigen::MatrixXd *weight) const
+{
+  if (state.ik_option_.adaptive_damping == true)
+  {
+    IKJointVector route_weight =
+        (weight == NULL) ? IKJointVector(IKJointVector::Ones(idx.size())) : getRouteWeight(idx, *weight);
+    LevenbergMarquardtIKPolicy policy(route_weight, 1e-5);
+
+    return solveInverseKinematics(state, idx, to, tar_position, tar_orientation, max_iter, ik_err, policy);
+  }
+
+  if (weight == NULL)
+    return solveInverseKinematics(state, idx, to, tar_position, tar_orientation, max_iter, ik_err,
+                                  PseudoInverseIKPolicy());
+
+  WeightedDampedIKPolicy policy(getRouteWeight(idx, *weight), 1e-5, 1e-5);
+
+  return solveInverseKinematics(state, idx, to, tar_position, tar_orientation, max_iter, ik_err, policy);
+}
+
+IKJointVector OP3Model::getRouteWeight(const JointRoute &idx, const Eigen::MatrixXd &weight) const
+{
+  // weight is given per joint id
+  IKJointVector route_weight(idx.size());
+
+  for (int ix = 0; ix < idx.size(); ix++)
+    route_weight.coeffRef(ix) = weight.coeff(idx[ix], 0);
+
+  return route_weight;
+}
+
+// caches compare the ids, not the address of a route
+static bool isSameRoute(const int *joint_id, int joint_count, const JointRoute &idx)
+{
+  if (joint_count != idx.size())
+    return false;
+
+  for (int id = 0; id < joint_count; id++)
+  {
+    if (joint_id[id] != idx[id])
+      return false;
+  }
+
+  return true;
+}
+
+void OP3Model::applyWarmStart(KinematicsState &state, const JointRoute &idx, int to,
+                              const Eigen::Vector3d &tar_position, const Eigen::Matrix3d &tar_orientation) const
+{
+  int cached_count = state.ik_warm_start_joint_count_[to];
+  if (cached_count == 0 || isSameRoute(state.ik_warm_start_joint_[to], cached_count, idx) == false)
+    return;
+
+  double curr_err = calcPoseError(tar_position, state.position_[to], tar_orientation, state.orientation_[to]).norm();
+
+  double curr_angle[ALL_JOINT_ID + 1];
+  for (int id = 0; id < idx.size(); id++)
+  {
+    curr_angle[id] = state.joint_angle_[idx[id]];
+    state.joint_angle_[idx[id]] = state.ik_warm_start_angle_[to][id];
+  }
+  updateKinematics(state);
+
+  double warm_err = calcPoseError(tar_position, state.position_[to], tar_orientation, state.orientation_[to]).norm();
+
+  if (warm_err < curr_err)
+  {
+    state.ik_result_.warm_started = true;
+    return;
+  }
+
+  // the current angles are closer, go back to them
+  for (int id = 0; id < idx.size(); id++)
+    state.joint_angle_[idx[id]] = curr_angle[id];
+  updateKinematics(state);
+}
+
+template<typename IKPolicy>
+bool OP3Model::solveInverseKinematics(KinematicsState &state, const JointRoute &idx, int to,
+                                      const Eigen::Vector3d &tar_position, const Eigen::Matrix3d &tar_orientation,
+                                      int max_iter, double ik_err, const IKPolicy &policy) const
+{
+  const InverseKinematicsOption &option = state.ik_option_;
+  InverseKinematicsResult &result = state.ik_result_;
+
+  result = InverseKinematicsResult();
+
+  if (option.warm_start == true)
+    applyWarmStart(state, idx, to, tar_position, tar_orientation);
+
+  IKJacobian jacobian;
+  IKJointVector delta_angle;
+  bool clamped = false;
+  double prev_residual = 0.0;
+
+  for (int iter = 0; iter < max_iter; iter++)
+  {
+    calcJacobian(state, idx, jacobian);
+
+    IKError err = calcPoseError(tar_position, state.position_[to], tar_orientation, state.orientation_[to]);
+
+    result.residual = err.norm();
+    if (result.residual < ik_err)
+    {
+      result.converged = true;
+      break;
+    }
+
+    // a joint is held at its limit and the error stopped decreasing : the target is out of reach
+    if (clamped == true && result.residual >= prev_residual)
+    {
+      result.limit_blocked = true;
+      break;
+    }
+    prev_residual = result.residual;
+
+    policy.calcJointStep(jacobian, err, delta_angle);
+
+    clamped = false;
+    for (int id = 0; id < idx.size(); id++)
+    {
+      int joint_id = idx[id];
+      double &joint_angle = state.joint_angle_[joint_id];
+      joint_angle += delta_angle.coeff(id);
+
+      if (option.clamp_joint_limit == false)
+        continue;
+
+      if (joint_angle > joint_limit_max_[joint_id])
+      {
+        joint_angle = joint_limit_max_[joint_id];
+        clamped = true;
+      }
+      else if (joint_angle < joint_limit_min_[joint_id])
+      {
+        joint_angle = joint_limit_min_[joint_id];
+        clamped = true;
+      }
+    }
+
+    updateKinematics(state);
+    result.iterations++;
+  }
+
+  /* check joint limit */
+  for (int id = 0; id < idx.size(); id++)
+  {
+    int joint_id = idx[id];
+    double joint_angle = state.joint_angle_[joint_id];
+
+    // clamped joints may rest exactly on a limit
+    if (option.clamp_joint_limit == true)
+    {
+      if (joint_angle > joint_limit_max_[joint_id] || joint_angle < joint_limit_min_[joint_id])
+        result.limit_violations++;
+    }
+    else if (joint_angle >= joint_limit_max_[joint_id] || joint_angle <= joint_limit_min_[joint_id])
+      result.limit_violations++;
+  }
+
+  if (result.converged == false || result.limit_violations > 0)
+    return false;
+
+  state.ik_warm_start_joint_count_[to] = idx.size();
+  for (int id = 0; id < idx.size(); id++)
+  {
+    state.ik_warm_start_joint_[to][id] = idx[id];
+    state.ik_warm_start_angle_[to][id] = state.joint_angle_[idx[id]];
+  }
+
+  return true;
+}
+
+template bool OP3Model::solveInverseKinematics<PseudoInverseIKPolicy>(
+    KinematicsState &state, const JointRoute &idx, int to, const Eigen::Vector3d &tar_position,
+    const Eigen::Matrix3d &tar_orientation, int max_iter, double ik_err, const PseudoInverseIKPolicy &policy) const;
+template bool OP3Model::solveInverseKinematics<WeightedDampedIKPolicy>(
+    KinematicsState &state, const JointRoute &idx, int to, const Eigen::Vector3d &tar_position,
+    const Eigen::Matrix3d &tar_orientation, int max_iter, double ik_err, const WeightedDampedIKPolicy &policy) const;
+template bool OP3Model::solveInverseKinematics<LevenbergMarquardtIKPolicy>(
+    KinematicsState &state, const JointRoute &idx, int to, const Eigen::Vector3d &tar_position,
+    const Eigen::Matrix3d &tar_orientation, int max_iter, double ik_err,
+    const LevenbergMarquardtIKPolicy &policy) const;
+
+bool OP3Model::calcDifferentialInverseKinematics(KinematicsState &state, const JointRoute &idx, int to,
+                                                 const Eigen::Vector3d &tar_position,
+                                                 const Eigen::Matrix3d &tar_orientation, double ik_err,
+                                                 const DifferentialIKOption &option) const
+{
+  InverseKinematicsResult &result = state.ik_result_;
+
+  result = InverseKinematicsResult();
+
+  int joint_count = idx.size();
+  if (joint_count == 0)
+    return false;
+
+  updateKinematics(state);
+
+  IKError err = calcPoseError(tar_position, state.position_[to], tar_orientation, state.orientation_[to]);
+
+  result.residual = err.norm();
+  if (result.residual < ik_err)
+  {
+    result.converged = true;
+    return true;
+  }
+
+  // the same route as one of the last calls, the factorization is kept while its joints barely move
+  KinematicsState::DifferentialIKCache *cache = NULL;
+  for (int ix = 0; ix < KinematicsState::DIFFERENTIAL_IK_CACHE_SIZE; ix++)
+  {
+    KinematicsState::DifferentialIKCache &slot = state.differential_ik_cache_[ix];
+    if (slot.valid == true && slot.to == to && isSameRoute(slot.joint_id, slot.joint_count, idx) == true)
+    {
+      cache = &slot;
+      break;
+    }
+  }
+
+  bool reuse = (cache != NULL && option.reuse_threshold > 0.0);
+  if (reuse == true)
+  {
+    for (int id = 0; id < joint_count; id++)
+    {
+      if (fabs(state.joint_angle_[idx[id]] - cache->angle[id]) > option.reuse_threshold)
+      {
+        reuse = false;
+        break;
+      }
+    }
+  }
+
+  if (cache == NULL)
+  {
+    cache = &state.differential_ik_cache_[state.differential_ik_cache_next_];
+    state.differential_ik_cache_next_ = (state.differential_ik_cache_next_ + 1) % KinematicsState::DIFFERENTIAL_IK_CACHE_SIZE;
+  }
+
+  if (reuse == false)
+  {
+    calcJacobian(state, idx, cache->jacobian);
+
+    // G = J^T (J J^T + damping)^-1, a step is then G e
+    IKSquareMatrix jacobian_trans;
+    jacobian_trans.noalias() = cache->jacobian * cache->jacobian.transpose();
+    jacobian_trans.diagonal().array() += option.damping;
+
+    cache->gain.noalias() = cache->jacobian.transpose() * jacobian_trans.ldlt().solve(IKSquareMatrix::Identity());
+
+    cache->valid = true;
+    cache->to = to;
+    cache->joint_count = joint_count;
+    for (int id = 0; id < joint_count; id++)
+    {
+      cache->joint_id[id] = idx[id];
+      cache->angle[id] = state.joint_angle_[idx[id]];
+    }
+  }
+  result.jacobian_reused = reuse;
+
+  IKJointVector delta_angle;
+  delta_angle.noalias() = cache->gain * (option.gain * err);
+
+  // joints inside the margin of a limit are pushed back, without disturbing the task
+  if (option.limit_avoidance_gain > 0.0)
+  {
+    IKJointVector limit_push = IKJointVector::Zero(joint_count);
+    bool pushed = false;
+
+    for (int id = 0; id < joint_count; id++)
+    {
+      int joint_id = idx[id];
+      double joint_angle = state.joint_angle_[joint_id];
+
+      if (joint_angle > joint_limit_max_[joint_id] - option.limit_margin)
+        limit_push.coeffRef(id) = joint_limit_max_[joint_id] - option.limit_margin - joint_angle;
+      else if (joint_angle < joint_limit_min_[joint_id] + option.limit_margin)
+        limit_push.coeffRef(id) = joint_limit_min_[joint_id] + option.limit_margin - joint_angle;
+      else
+        continue;
+
+      pushed = true;
+    }
+
+    if (pushed == true)
+    {
+      limit_push *= option.limit_avoidance_gain;
+
+      IKError task_push;
+      task_push.noalias() = cache->jacobian * limit_push;
+      delta_angle += limit_push;
+      delta_angle.noalias() -= cache->gain * task_push;
+    }
+  }
+
+  // scaled as a whole, so the step keeps its direction
+  double max_delta = option.max_joint_velocity * option.control_cycle;
+  double largest_delta = delta_angle.cwiseAbs().maxCoeff();
+  if (largest_delta > max_delta)
+    delta_angle *= max_delta / largest_delta;
+
+  for (int id = 0; id < joint_count; id++)
+  {
+    int joint_id = idx[id];
+    double &joint_angle = state.joint_angle_[joint_id];
+    joint_angle += delta_angle.coeff(id);
+
+    if (joint_angle > joint_limit_max_[joint_id])
+    {
+      joint_angle = joint_limit_max_[joint_id];
+      result.limit_blocked = true;
+    }
+    else if (joint_angle < joint_limit_min_[joint_id])
+    {
+      joint_angle = joint_limit_min_[joint_id];
+      result.limit_blocked = true;
+    }
+  }
+
+  updateKinematics(state);
+  result.iterations = 1;
+
+  return false;
+}
+
+int OP3Model::calcWholeBodyTask(KinematicsState &state, const WholeBodyIKTask &task, const int *column,
+                                Eigen::Matrix<double, 6, ALL_JOINT_ID + 1> &jacobian, IKError &err) const
+{
+  jacobian.setZero();
+
+  if (task.type == COMTask)
+  {
+    if (state.branch_mc_valid_ == false)
+      calcBranchMC(state);
+
+    double total_mass = tree_branch_mass_[0];
+
+    // turning a joint moves the COM of its subtree, the link and the branch of its first child
+    for (int pos = 0; pos < link_count_; pos++)
+    {
+      int id = tree_order_[pos];
+      if (column[id] == -1)
+        continue;
+
+      int child = tree_child_[pos];
+      Eigen::Vector3d mc = tree_mass_[pos] * (state.orientation_[id] * tree_center_of_mass_[pos] + state.position_[id]);
+      double mass = tree_mass_[pos];
+      if (child != -1)
+      {
+        mc += state.branch_mc_[child];
+        mass += tree_branch_mass_[child];
+      }
+
+      Eigen::Vector3d axis = calcWorldJointAxis(id, state.orientation_[id]);
+      jacobian.block<3, 1>(0, column[id]) = axis.cross(mc - mass * state.position_[id]) / total_mass;
+    }
+
+    err.head<3>() = task.target_position - state.branch_mc_[0] / total_mass;
+    return 3;
+  }
+
+  int link_id = task.link_id;
+  const Eigen::Vector3d &position = state.position_[link_id];
+  const Eigen::Matrix3d &orientation = state.orientation_[link_id];
+
+  // only the ancestors of the link move it
+  int orientation_row = (task.type == OrientationTask) ? 0 : 3;
+  for (int ix = 0; ix < route_length_[link_id]; ix++)
+  {
+    int joint_id = route_table_[link_id][ix];
+    if (column[joint_id] == -1)
+      continue;
+
+    Eigen::Vector3d axis = calcWorldJointAxis(joint_id, state.orientation_[joint_id]);
+
+    if (task.type != OrientationTask)
+      jacobian.block<3, 1>(0, column[joint_id]) = axis.cross(position - state.position_[joint_id]);
+    if (task.type != PositionTask)
+      jacobian.block<3, 1>(orientation_row, column[joint_id]) = axis;
+  }
+
+  IKError pose_err = calcPoseError(task.target_position, position, task.target_orientation, orientation);
+
+  if (task.type == PositionTask)
+  {
+    err.head<3>() = pose_err.head<3>();
+    return 3;
+  }
+  if (task.type == OrientationTask)
+  {
+    err.head<3>() = pose_err.tail<3>();
+    return 3;
+  }
+
+  err = pose_err;
+  return 6;
+}
+
+bool OP3Model::calcWholeBodyInverseKinematics(KinematicsState &state, const WholeBodyIKProblem &problem,
+                                              int max_iter, double ik_err) const
+{
+  // bounded storage, so a solve does not touch the heap
+  typedef Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::ColMajor,
+      6 * WHOLE_BODY_IK_MAX_TASK, ALL_JOINT_ID + 1> LevelJacobian;
+  typedef Eigen::Matrix<double, Eigen::Dynamic, 1, Eigen::ColMajor, 6 * WHOLE_BODY_IK_MAX_TASK, 1> LevelVector;
+  typedef Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::ColMajor,
+      6 * WHOLE_BODY_IK_MAX_TASK, 6 * WHOLE_BODY_IK_MAX_TASK> LevelSquareMatrix;
+  typedef Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::ColMajor,
+      ALL_JOINT_ID + 1, ALL_JOINT_ID + 1> NullSpaceProjector;
+
+  const InverseKinematicsOption &option = state.ik_option_;
+  InverseKinematicsResult &result = state.ik_result_;
+
+  result = InverseKinematicsResult();
+
+  // one column per selected joint, in link id order
+  int column[ALL_JOINT_ID + 1];
+  int column_id[ALL_JOINT_ID + 1];
+  int joint_count = 0;
+
+  for (int id = 0; id <= ALL_JOINT_ID; id++)
+  {
+    column[id] = -1;
+    if (problem.joint_select[id] == false || tree_index_[id] == -1 || joint_axis_type_[id] == JointAxisNone)
+      continue;
+
+    column[id] = joint_count;
+    column_id[joint_count++] = id;
+  }
+
+  if (joint_count == 0 || problem.task_count <= 0 || problem.task_count > WHOLE_BODY_IK_MAX_TASK)
+    return false;
+
+  // distinct priorities, highest (smallest) first
+  int level_priority[WHOLE_BODY_IK_MAX_TASK];
+  int level_count = 0;
+
+  for (int task_index = 0; task_index < problem.task_count; task_index++)
+  {
+    const WholeBodyIKTask &task = problem.task[task_index];
+    if (task.type != COMTask && (task.link_id < 0 || task.link_id > ALL_JOINT_ID || tree_index_[task.link_id] == -1))
+      return false;
+
+    int ix = level_count;
+    while (ix > 0 && level_priority[ix - 1] > task.priority)
+      ix--;
+    if (ix > 0 && level_priority[ix - 1] == task.priority)
+      continue;
+
+    for (int move = level_count; move > ix; move--)
+      level_priority[move] = level_priority[move - 1];
+    level_priority[ix] = task.priority;
+    level_count++;
+  }
+
+  Eigen::Matrix<double, 6, ALL_JOINT_ID + 1> task_jacobian[WHOLE_BODY_IK_MAX_TASK];
+  IKError task_err[WHOLE_BODY_IK_MAX_TASK];
+  int task_rows[WHOLE_BODY_IK_MAX_TASK];
+
+  LevelJacobian level_jacobian;
+  LevelJacobian projected_jacobian;
+  LevelVector level_err;
+  LevelSquareMatrix level_square;
+  NullSpaceProjector null_space;
+  IKJointVector delta_angle;
+
+  bool clamped = false;
+  double prev_residual = 0.0;
+
+  updateKinematics(state);
+
+  for (int iter = 0; iter < max_iter; iter++)
+  {
+    result.residual = 0.0;
+    for (int task_index = 0; task_index < problem.task_count; task_index++)
+    {
+      task_rows[task_index] = calcWholeBodyTask(state, problem.task[task_index], column, task_jacobian[task_index],
+                                                task_err[task_index]);
+      result.residual = std::max(result.residual, task_err[task_index].head(task_rows[task_index]).norm());
+    }
+
+    if (result.residual < ik_err)
+    {
+      result.converged = true;
+      break;
+    }
+
+    // a joint is held at its limit and the error stopped decreasing : the targets are out of reach
+    if (clamped == true && result.residual >= prev_residual)
+    {
+      result.limit_blocked = true;
+      break;
+    }
+    prev_residual = result.residual;
+
+    delta_angle.setZero(joint_count);
+    null_space.setIdentity(joint_count, joint_count);
+
+    for (int level = 0; level < level_count; level++)
+    {
+      int rows = 0;
+      for (int task_index = 0; task_index < problem.task_count; task_index++)
+        if (problem.task[task_index].priority == level_priority[level])
+          rows += task_rows[task_index];
+
+      level_jacobian.resize(rows, joint_count);
+      level_err.resize(rows);
+
+      int row = 0;
+      for (int task_index = 0; task_index < problem.task_count; task_index++)
+      {
+        const WholeBodyIKTask &task = problem.task[task_index];
+        if (task.priority != level_priority[level])
+          continue;
+
+        double weight = sqrt(task.weight);
+        int task_row = task_rows[task_index];
+
+        level_jacobian.middleRows(row, task_row) = weight * task_jacobian[task_index].topLeftCorner(task_row, joint_count);
+        level_err.segment(row, task_row) = weight * task_err[task_index].head(task_row);
+        row += task_row;
+      }
+
+      // what the higher levels left of the error, solved inside their null space
+      level_err.noalias() -= level_jacobian * delta_angle;
+      projected_jacobian.noalias() = level_jacobian * null_space;
+
+      level_square.noalias() = projected_jacobian * projected_jacobian.transpose();
+      level_square.diagonal().array() += problem.damping;
+
+      Eigen::LDLT<LevelSquareMatrix> ldlt(level_square);
+
+      delta_angle.noalias() += projected_jacobian.transpose() * ldlt.solve(level_err);
+      null_space.noalias() -= projected_jacobian.transpose() * ldlt.solve(projected_jacobian);
+    }
+
+    if (problem.posture_gain > 0.0)
+    {
+      IKJointVector posture_err(joint_count);
+      for (int col = 0; col < joint_count; col++)
+        posture_err.coeffRef(col) = problem.posture_gain
+            * (problem.posture_angle[column_id[col]] - state.joint_angle_[column_id[col]]);
+
+      delta_angle.noalias() += null_space * posture_err;
+    }
+
+    double max_delta = delta_angle.cwiseAbs().maxCoeff();
+    if (max_delta > problem.max_step)
+      delta_angle *= problem.max_step / max_delta;
+
+    clamped = false;
+    for (int col = 0; col < joint_count; col++)
+    {
+      int joint_id = column_id[col];
+      double &joint_angle = state.joint_angle_[joint_id];
+      joint_angle += delta_angle.coeff(col);
+
+      if (option.clamp_joint_limit == false)
+        continue;
+
+      if (joint_angle > joint_limit_max_[joint_id])
+      {
+        joint_angle = joint_limit_max_[joint_id];
+        clamped = true;
+      }
+      else if (joint_angle < joint_limit_min_[joint_id])
+      {
+        joint_angle = joint_limit_min_[joint_id];
+        clamped = true;
+      }
+    }
+
+    updateKinematics(state);
+    result.iterations++;
+  }
+
+  for (int col = 0; col < joint_count; col++)
+  {
+    int joint_id = column_id[col];
+    double joint_angle = state.joint_angle_[joint_id];
+
+    if (option.clamp_joint_limit == true)
+    {
+      if (joint_angle > joint_limit_max_[joint_id] || joint_angle < joint_limit_min_[joint_id])
+        result.limit_violations++;
+    }
+    else if (joint_angle >= joint_limit_max_[joint_id] || joint_angle <= joint_limit_min_[joint_id])
+      result.limit_violations++;
+  }
+
+  return (result.converged == true && result.limit_violations == 0);
+}
+
+bool OP3Model::calcInverseKinematicsForLeg(double *out, double x, double y, double z, double roll, double pitch,
+                                           double yaw) const
+{
+  Eigen::Matrix3d R06 = robotis_framework::convertRPYToRotation(roll, pitch, yaw);
+  Eigen::Vector3d p06 = robotis_framework::getTransitionXYZ(x, y, z) + ankle_length_m_*R06.block<3,1>(0,2); //desired hip to ankle
+
+  //calc q6
+  Eigen::Vector3d p60 = -R06.transpose()*p06;
+  *(out + 5) = atan2(p60(1), p60(2));
+
+  //calc q1
+  Eigen::Matrix3d R05 = R06*robotis_framework::getRotationX(-(*(out + 5)));
+  *(out + 0) = atan2(-R05(0, 1), R05(1, 1));
+
+  //calc q4
+  Eigen::Vector3d p03 = robotis_framework::getRotationZ(*(out + 0))*robotis_framework::getTransitionXYZ(hip_pitch_offset_m_, 0, 0);
+  Eigen::Vector3d p36 = p06 - p03;
+
+  *(out + 3) = -acos((thigh_length_m_*thigh_length_m_ + calf_length_m_*calf_length_m_ - p36.norm()*p36.norm())/(2*thigh_length_m_*calf_length_m_)) + EIGEN_PI;
+
+  //calc q5
+  double alpha = asin(thigh_length_m_*sin(EIGEN_PI - *(out + 3))/p36.norm());
+  Eigen::Vector3d p63 = -R06.transpose()*p36;
+  *(out + 4) = -atan2(p63(0), getSign(p63(2))*sqrt(p63(1)*p63(1) + p63(2)*p63(2))) - alpha;
+
+  //calc q2 and q3
+  Eigen::Matrix3d R13 = robotis_framework::getRotationZ(-(*(out + 0))) * R05 * robotis_framework::getRotationY( -(*(out + 4) + *(out + 3)) );
+  *(out + 1) = atan2(R13(2,1), R13(1,1));
+  *(out + 2) = atan2(R13(0,2), R13(0,0));
+
+  *(out + 2) += hip_offset_angle_rad_;
+  *(out + 3) += -hip_offset_angle_rad_;
+
+  return true;
+}
+
+bool OP3Model::calcInverseKinematicsForRightLeg(double *out, double x, double y, double z, double roll,
+                                                double pitch, double yaw) const
+{
+  if (calcInverseKinematicsForLeg(out, x, y, z, roll, pitch, yaw) == true)
+  {
+    for(int ix = 0 ; ix < 6; ix++)
+      out[ix] *= getJointDirection(ID_R_LEG_START + 2 * ix);
+
+    return true;
+  }
+  else
+    return false;
+}
+
+bool OP3Model::calcInverseKinematicsForLeftLeg(double *out, double x, double y, double z, double roll,
+                                               double pitch, double yaw) const
+{
+  if (calcInverseKinematicsForLeg(out, x, y, z, roll, pitch, yaw) == true)
+  {
+    for(int ix = 0 ; ix < 6; ix++)
+      out[ix] *= getJointDirection(ID_L_LEG_START + 2 * ix);
+
+    return true;
+  }
+  else
+    return false;
+}
+
+int OP3Model::calcInverseKinematicsForRightLeg(const LegPoseArray &pose, LegJointArray &out, int count) const
+{
+  return calcLegInverseKinematicsBatch(getLegIKParameter(ID_R_LEG_START), pose, out, count);
+}
+
+int OP3Model::calcInverseKinematicsForLeftLeg(const LegPoseArray &pose, LegJointArray &out, int count) const
+{
+  return calcLegInverseKinematicsBatch(getLegIKParameter(ID_L_LEG_START), pose, out, count);
+}
+
+int OP3Model::calcInverseKinematicsForArm(int arm_start_id, const Eigen::Vector3d &tar_position,
+                                          ArmIKSolution &solution) const
+{
+  solution.count = 0;
+
+  if (arm_start_id != ID_R_ARM_START && arm_start_id != ID_L_ARM_START)
+    return 0;
+
+  // shoulder pitch about y, then shoulder roll and elbow about parallel x axes
+  int joint_id[MAX_ARM_ID] = { arm_start_id, arm_start_id + 2, arm_start_id + 4 };
+  if (joint_axis_type_[joint_id[0]] != JointAxisY || joint_axis_type_[joint_id[1]] != JointAxisX
+      || joint_axis_type_[joint_id[2]] != JointAxisX || tree_child_[tree_index_[joint_id[2]]] < 0)
+    return 0;
+
+  const Eigen::Vector3d &shoulder = tree_relative_position_[tree_index_[joint_id[0]]];
+  const Eigen::Vector3d &roll_offset = tree_relative_position_[tree_index_[joint_id[1]]];
+  const Eigen::Vector3d &elbow_offset = tree_relative_position_[tree_index_[joint_id[2]]];
+  const Eigen::Vector3d &hand_offset = tree_relative_position_[tree_child_[tree_index_[joint_id[2]]]];
+
+  // the x axis rotations keep the x of the shoulder pitch frame
+  Eigen::Vector3d target = tar_position - shoulder;
+  double arm_x = roll_offset.x() + elbow_offset.x() + hand_offset.x();
+  double pitch_plane = target.x() * target.x() + target.z() * target.z() - arm_x * arm_x;
+  if (pitch_plane < 0.0)
+    return 0;
+
+  // elbow : |elbow_offset + Rx(elbow) hand_offset| in the yz plane = a cos(elbow) + b sin(elbow) + c
+  double a = elbow_offset.y() * hand_offset.y() + elbow_offset.z() * hand_offset.z();
+  double b = elbow_offset.z() * hand_offset.y() - elbow_offset.y() * hand_offset.z();
+  double c = 0.5 * (elbow_offset.y() * elbow_offset.y() + elbow_offset.z() * elbow_offset.z()
+                    + hand_offset.y() * hand_offset.y() + hand_offset.z() * hand_offset.z());
+  double elbow_norm = sqrt(a * a + b * b);
+  double elbow_phase = atan2(b, a);
+  if (elbow_norm < 1e-9)
+    return 0;
+
+  int within_limit_count = 0;
+
+  for (int pitch_branch = 0; pitch_branch < 2; pitch_branch++)
+  {
+    double shoulder_z = (pitch_branch == 0 ? 1.0 : -1.0) * sqrt(pitch_plane);
+    double forearm_y = target.y() - roll_offset.y();
+    double forearm_z = shoulder_z - roll_offset.z();
+
+    double elbow_cos = (0.5 * (forearm_y * forearm_y + forearm_z * forearm_z) - c) / elbow_norm;
+    if (elbow_cos > 1.0 || elbow_cos < -1.0)
+      continue;
+
+    double pitch = atan2(target.x(), target.z()) - atan2(arm_x, shoulder_z);
+
+    for (int elbow_branch = 0; elbow_branch < 2; elbow_branch++)
+    {
+      double elbow = elbow_phase + (elbow_branch == 0 ? 1.0 : -1.0) * acos(elbow_cos);
+      double sin_elbow = sin(elbow), cos_elbow = cos(elbow);
+      double link_y = elbow_offset.y() + cos_elbow * hand_offset.y() - sin_elbow * hand_offset.z();
+      double link_z = elbow_offset.z() + sin_elbow * hand_offset.y() + cos_elbow * hand_offset.z();
+      double roll = atan2(forearm_z, forearm_y) - atan2(link_z, link_y);
+
+      double angle[MAX_ARM_ID] = { pitch, roll, elbow };
+      double *joint = solution.joint[solution.count];
+      bool within_limit = true;
+
+      for (int ix = 0; ix < MAX_ARM_ID; ix++)
+      {
+        joint[ix] = joint_axis_sign_[joint_id[ix]] * angle[ix];
+        joint[ix] = atan2(sin(joint[ix]), cos(joint[ix]));
+        if (joint[ix] > joint_limit_max_[joint_id[ix]] || joint[ix] < joint_limit_min_[joint_id[ix]])
+          within_limit = false;
+      }
+
+      solution.within_limit[solution.count++] = within_limit;
+      if (within_limit == true)
+        within_limit_count++;
+    }
+  }
+
+  return within_limit_count;
+}
+
+bool OP3Model::calcInverseKinematicsForArm(double *out, int arm_start_id, const Eigen::Vector3d &tar_position,
+                                           const double *curr_angle) const
+{
+  ArmIKSolution solution;
+  if (calcInverseKinematicsForArm(arm_start_id, tar_position, solution) == 0)
+    return false;
+
+  int nearest = -1;
+  double nearest_distance = 0.0;
+
+  for (int ix = 0; ix < solution.count; ix++)
+  {
+    if (solution.within_limit[ix] == false)
+      continue;
+
+    double distance = 0.0;
+    for (int joint = 0; joint < MAX_ARM_ID; joint++)
+    {
+      double diff = solution.joint[ix][joint] - curr_angle[joint];
+      distance += diff * diff;
+    }
+
+    if (nearest < 0 || distance < nearest_distance)
+    {
+      nearest = ix;
+      nearest_distance = distance;
+    }
+  }
+
+  for (int joint = 0; joint < MAX_ARM_ID; joint++)
+    out[joint] = solution.joint[nearest][joint];
+
+  return true;
+}
+
+LegIKParameter OP3Model::getLegIKParameter(int leg_start_id) const
+{
+  LegIKParameter param;
+
+  param.thigh_length_m = thigh_length_m_;
+  param.calf_length_m = calf_length_m_;
+  param.ankle_length_m = ankle_length_m_;
+  param.hip_pitch_offset_m = hip_pitch_offset_m_;
+  param.hip_offset_angle_rad = hip_offset_angle_rad_;
+
+  for (int ix = 0; ix < MAX_LEG_ID; ix++)
+  {
+    int joint_id = leg_start_id + 2 * ix;
+
+    param.joint_direction[ix] = getJointDirection(joint_id);
+    param.joint_limit_min[ix] = joint_limit_min_[joint_id];
+    param.joint_limit_max[ix] = joint_limit_max_[joint_id];
+  }
+
+  return param;
+}
+
+}
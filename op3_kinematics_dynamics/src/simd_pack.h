@@ -0,0 +1,275 @@
+/*******************************************************************************
+* Copyright 2017 ROBOTIS CO., LTD.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+/* Author: Kayman */
+
+#ifndef SIMD_PACK_H_
+#define SIMD_PACK_H_
+
+// lane packs used by the batch kernels of this package, not installed.
+// the kernels are written once against these and instantiated per instruction set
+
+#include <cmath>
+
+#if defined(__AVX__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+namespace robotis_op
+{
+
+namespace simd
+{
+
+struct ScalarMask
+{
+  bool m;
+};
+
+struct ScalarPack
+{
+  typedef ScalarMask Mask;
+  static const int SIZE = 1;
+
+  double v;
+
+  static ScalarPack make(double value)
+  {
+    ScalarPack pack;
+    pack.v = value;
+    return pack;
+  }
+  static ScalarPack load(const double *ptr)
+  {
+    return make(*ptr);
+  }
+  void store(double *ptr) const
+  {
+    *ptr = v;
+  }
+};
+
+inline ScalarPack operator+(ScalarPack a, ScalarPack b) { return ScalarPack::make(a.v + b.v); }
+inline ScalarPack operator-(ScalarPack a, ScalarPack b) { return ScalarPack::make(a.v - b.v); }
+inline ScalarPack operator*(ScalarPack a, ScalarPack b) { return ScalarPack::make(a.v * b.v); }
+inline ScalarPack operator/(ScalarPack a, ScalarPack b) { return ScalarPack::make(a.v / b.v); }
+inline ScalarPack operator-(ScalarPack a) { return ScalarPack::make(-a.v); }
+inline ScalarPack packSqrt(ScalarPack a) { return ScalarPack::make(std::sqrt(a.v)); }
+inline ScalarPack packAbs(ScalarPack a) { return ScalarPack::make(std::fabs(a.v)); }
+inline ScalarMask lessThan(ScalarPack a, ScalarPack b) { ScalarMask m = { a.v < b.v }; return m; }
+inline ScalarMask lessEqual(ScalarPack a, ScalarPack b) { ScalarMask m = { a.v <= b.v }; return m; }
+inline ScalarMask equal(ScalarPack a, ScalarPack b) { ScalarMask m = { a.v == b.v }; return m; }
+inline ScalarMask operator&(ScalarMask a, ScalarMask b) { ScalarMask m = { a.m && b.m }; return m; }
+inline ScalarMask operator|(ScalarMask a, ScalarMask b) { ScalarMask m = { a.m || b.m }; return m; }
+inline ScalarPack select(ScalarMask m, ScalarPack a, ScalarPack b) { return m.m ? a : b; }
+inline void storeMask(ScalarMask m, unsigned char *ptr) { ptr[0] = m.m ? 1 : 0; }
+
+#if defined(__SSE2__)
+struct SSE2Mask
+{
+  __m128d m;
+};
+
+struct SSE2Pack
+{
+  typedef SSE2Mask Mask;
+  static const int SIZE = 2;
+
+  __m128d v;
+
+  static SSE2Pack make(__m128d value)
+  {
+    SSE2Pack pack;
+    pack.v = value;
+    return pack;
+  }
+  static SSE2Pack make(double value)
+  {
+    return make(_mm_set1_pd(value));
+  }
+  static SSE2Pack load(const double *ptr)
+  {
+    return make(_mm_loadu_pd(ptr));
+  }
+  void store(double *ptr) const
+  {
+    _mm_storeu_pd(ptr, v);
+  }
+};
+
+inline SSE2Mask makeMask(__m128d m) { SSE2Mask mask; mask.m = m; return mask; }
+inline SSE2Pack operator+(SSE2Pack a, SSE2Pack b) { return SSE2Pack::make(_mm_add_pd(a.v, b.v)); }
+inline SSE2Pack operator-(SSE2Pack a, SSE2Pack b) { return SSE2Pack::make(_mm_sub_pd(a.v, b.v)); }
+inline SSE2Pack operator*(SSE2Pack a, SSE2Pack b) { return SSE2Pack::make(_mm_mul_pd(a.v, b.v)); }
+inline SSE2Pack operator/(SSE2Pack a, SSE2Pack b) { return SSE2Pack::make(_mm_div_pd(a.v, b.v)); }
+inline SSE2Pack operator-(SSE2Pack a) { return SSE2Pack::make(_mm_xor_pd(a.v, _mm_set1_pd(-0.0))); }
+inline SSE2Pack packSqrt(SSE2Pack a) { return SSE2Pack::make(_mm_sqrt_pd(a.v)); }
+inline SSE2Pack packAbs(SSE2Pack a) { return SSE2Pack::make(_mm_andnot_pd(_mm_set1_pd(-0.0), a.v)); }
+inline SSE2Mask lessThan(SSE2Pack a, SSE2Pack b) { return makeMask(_mm_cmplt_pd(a.v, b.v)); }
+inline SSE2Mask lessEqual(SSE2Pack a, SSE2Pack b) { return makeMask(_mm_cmple_pd(a.v, b.v)); }
+inline SSE2Mask equal(SSE2Pack a, SSE2Pack b) { return makeMask(_mm_cmpeq_pd(a.v, b.v)); }
+inline SSE2Mask operator&(SSE2Mask a, SSE2Mask b) { return makeMask(_mm_and_pd(a.m, b.m)); }
+inline SSE2Mask operator|(SSE2Mask a, SSE2Mask b) { return makeMask(_mm_or_pd(a.m, b.m)); }
+inline SSE2Pack select(SSE2Mask m, SSE2Pack a, SSE2Pack b)
+{
+  return SSE2Pack::make(_mm_or_pd(_mm_and_pd(m.m, a.v), _mm_andnot_pd(m.m, b.v)));
+}
+inline void storeMask(SSE2Mask m, unsigned char *ptr)
+{
+  int bits = _mm_movemask_pd(m.m);
+  ptr[0] = bits & 1;
+  ptr[1] = (bits >> 1) & 1;
+}
+#endif
+
+#if defined(__AVX__)
+struct AVXMask
+{
+  __m256d m;
+};
+
+struct AVXPack
+{
+  typedef AVXMask Mask;
+  static const int SIZE = 4;
+
+  __m256d v;
+
+  static AVXPack make(__m256d value)
+  {
+    AVXPack pack;
+    pack.v = value;
+    return pack;
+  }
+  static AVXPack make(double value)
+  {
+    return make(_mm256_set1_pd(value));
+  }
+  static AVXPack load(const double *ptr)
+  {
+    return make(_mm256_loadu_pd(ptr));
+  }
+  void store(double *ptr) const
+  {
+    _mm256_storeu_pd(ptr, v);
+  }
+};
+
+inline AVXMask makeMask(__m256d m) { AVXMask mask; mask.m = m; return mask; }
+inline AVXPack operator+(AVXPack a, AVXPack b) { return AVXPack::make(_mm256_add_pd(a.v, b.v)); }
+inline AVXPack operator-(AVXPack a, AVXPack b) { return AVXPack::make(_mm256_sub_pd(a.v, b.v)); }
+inline AVXPack operator*(AVXPack a, AVXPack b) { return AVXPack::make(_mm256_mul_pd(a.v, b.v)); }
+inline AVXPack operator/(AVXPack a, AVXPack b) { return AVXPack::make(_mm256_div_pd(a.v, b.v)); }
+inline AVXPack operator-(AVXPack a) { return AVXPack::make(_mm256_xor_pd(a.v, _mm256_set1_pd(-0.0))); }
+inline AVXPack packSqrt(AVXPack a) { return AVXPack::make(_mm256_sqrt_pd(a.v)); }
+inline AVXPack packAbs(AVXPack a) { return AVXPack::make(_mm256_andnot_pd(_mm256_set1_pd(-0.0), a.v)); }
+inline AVXMask lessThan(AVXPack a, AVXPack b) { return makeMask(_mm256_cmp_pd(a.v, b.v, _CMP_LT_OQ)); }
+inline AVXMask lessEqual(AVXPack a, AVXPack b) { return makeMask(_mm256_cmp_pd(a.v, b.v, _CMP_LE_OQ)); }
+inline AVXMask equal(AVXPack a, AVXPack b) { return makeMask(_mm256_cmp_pd(a.v, b.v, _CMP_EQ_OQ)); }
+inline AVXMask operator&(AVXMask a, AVXMask b) { return makeMask(_mm256_and_pd(a.m, b.m)); }
+inline AVXMask operator|(AVXMask a, AVXMask b) { return makeMask(_mm256_or_pd(a.m, b.m)); }
+inline AVXPack select(AVXMask m, AVXPack a, AVXPack b) { return AVXPack::make(_mm256_blendv_pd(b.v, a.v, m.m)); }
+inline void storeMask(AVXMask m, unsigned char *ptr)
+{
+  int bits = _mm256_movemask_pd(m.m);
+  for (int ix = 0; ix < 4; ix++)
+    ptr[ix] = (bits >> ix) & 1;
+}
+#endif
+
+/* ----- math on packs ----- */
+
+// nearest integer, valid for |a| < 2^51
+template<typename P>
+inline P packRound(P a)
+{
+  const P magic = P::make(6755399441055744.0);  // 1.5 * 2^52
+  return (a + magic) - magic;
+}
+
+// the magic number trick needs strict double rounding, which x87 builds do not give
+inline ScalarPack packRound(ScalarPack a)
+{
+  return ScalarPack::make(std::floor(a.v + 0.5));
+}
+
+// cephes sin/cos with the argument reduced to [-pi/4, pi/4] around the nearest multiple of pi/2
+template<typename P>
+inline void packSinCos(P a, P &sin_out, P &cos_out)
+{
+  P k = packRound(a * P::make(0.63661977236758134308));  // 2 / pi
+  P r = ((a - k * P::make(2.0 * 7.85398125648498535156E-1)) - k * P::make(2.0 * 3.77489470793079817668E-8))
+      - k * P::make(2.0 * 2.69515142907905952645E-15);
+  P z = r * r;
+
+  P sin_r = ((((((P::make(1.58962301576546568060E-10) * z + P::make(-2.50507477628578072866E-8)) * z
+      + P::make(2.75573136213857245213E-6)) * z + P::make(-1.98412698295895385996E-4)) * z
+      + P::make(8.33333333332211858878E-3)) * z + P::make(-1.66666666666666307295E-1)) * z) * r + r;
+  P cos_r = (((((P::make(-1.13585365213876817300E-11) * z + P::make(2.08757008419747316778E-9)) * z
+      + P::make(-2.75573141792967388112E-7)) * z + P::make(2.48015872888517045348E-5)) * z
+      + P::make(-1.38888888888730564116E-3)) * z + P::make(4.16666666666665929218E-2)) * z * z
+      - P::make(0.5) * z + P::make(1.0);
+
+  // quadrant = k mod 4, found without integer lanes : floor(k / 4) = round(k / 4 - 0.375)
+  P quadrant = k - P::make(4.0) * packRound(k * P::make(0.25) - P::make(0.375));
+  typename P::Mask odd = equal(quadrant, P::make(1.0)) | equal(quadrant, P::make(3.0));
+  typename P::Mask sin_negative = equal(quadrant, P::make(2.0)) | equal(quadrant, P::make(3.0));
+  typename P::Mask cos_negative = equal(quadrant, P::make(1.0)) | equal(quadrant, P::make(2.0));
+
+  P s = select(odd, cos_r, sin_r);
+  P c = select(odd, sin_r, cos_r);
+  sin_out = select(sin_negative, -s, s);
+  cos_out = select(cos_negative, -c, c);
+}
+
+// cephes atan on [0, 1] combined with the octant of (x, y)
+template<typename P>
+inline P packAtan2(P y, P x)
+{
+  const P zero = P::make(0.0);
+
+  P abs_y = packAbs(y);
+  P abs_x = packAbs(x);
+  typename P::Mask swap = lessThan(abs_x, abs_y);
+  P num = select(swap, abs_x, abs_y);
+  P den = select(swap, abs_y, abs_x);
+  P a = select(equal(den, zero), zero, num / den);
+
+  typename P::Mask reduce = lessThan(P::make(0.66), a);
+  P t = select(reduce, (a - P::make(1.0)) / (a + P::make(1.0)), a);
+  P z = t * t;
+  P p = (((P::make(-8.750608600031904122785E-1) * z + P::make(-1.615753718733365076637E1)) * z
+      + P::make(-7.500855792314704667340E1)) * z + P::make(-1.228866684490136173410E2)) * z
+      + P::make(-6.485021904942025371773E1);
+  P q = ((((z + P::make(2.485846490142306297962E1)) * z + P::make(1.650270098316988542046E2)) * z
+      + P::make(4.328810604912902668951E2)) * z + P::make(4.853903996359136964868E2)) * z
+      + P::make(1.945506571482613964425E2);
+  P r = t * z * p / q + t;
+  r = select(reduce, r + P::make(0.5 * 6.123233995736765886130E-17) + P::make(M_PI / 4.0), r);
+
+  r = select(swap, P::make(M_PI / 2.0) - r, r);
+  r = select(lessThan(x, zero), P::make(M_PI) - r, r);
+  r = select(lessThan(y, zero), -r, r);
+
+  // NaN in, NaN out
+  return r + (x + y) * zero;
+}
+
+}
+
+}
+
+#endif /* SIMD_PACK_H_ */
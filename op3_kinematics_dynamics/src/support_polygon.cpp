@@ -0,0 +1,246 @@
+/*******************************************************************************
+* Copyright 2017 ROBOTIS CO., LTD.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+/* Author: Kayman */
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+#include "op3_kinematics_dynamics/support_polygon.h"
+
+namespace robotis_op
+{
+
+SupportPolygon::SupportPolygon()
+  : vertex_count_(0)
+{
+}
+
+void SupportPolygon::clear()
+{
+  vertex_count_ = 0;
+}
+
+double SupportPolygon::cross(int from, int to, double x, double y) const
+{
+  return (vertex_x_[to] - vertex_x_[from]) * (y - vertex_y_[from])
+      - (vertex_y_[to] - vertex_y_[from]) * (x - vertex_x_[from]);
+}
+
+bool SupportPolygon::addPoint(double x, double y)
+{
+  if (vertex_count_ == 0 || (vertex_count_ == 1 && (x != vertex_x_[0] || y != vertex_y_[0])))
+  {
+    vertex_x_[vertex_count_] = x;
+    vertex_y_[vertex_count_] = y;
+    vertex_count_++;
+    return true;
+  }
+
+  if (vertex_count_ == 1)
+    return true;
+
+  if (vertex_count_ == 2)
+  {
+    double side = cross(0, 1, x, y);
+
+    if (side == 0.0)
+    {
+      // still a segment, keep its two ends
+      double dx = vertex_x_[1] - vertex_x_[0], dy = vertex_y_[1] - vertex_y_[0];
+      double t = (dx * (x - vertex_x_[0]) + dy * (y - vertex_y_[0])) / (dx * dx + dy * dy);
+      int end = (t < 0.0 ? 0 : (t > 1.0 ? 1 : -1));
+
+      if (end >= 0)
+      {
+        vertex_x_[end] = x;
+        vertex_y_[end] = y;
+      }
+      return true;
+    }
+
+    // counterclockwise triangle
+    int index = (side > 0.0 ? 2 : 1);
+    if (index == 1)
+    {
+      vertex_x_[2] = vertex_x_[1];
+      vertex_y_[2] = vertex_y_[1];
+    }
+    vertex_x_[index] = x;
+    vertex_y_[index] = y;
+    vertex_count_ = 3;
+    return true;
+  }
+
+  // the edges that see the point form one run, its inner vertices are replaced by the point
+  bool visible[SUPPORT_POLYGON_MAX_VERTEX];
+  bool outside = false;
+
+  for (int ix = 0; ix < vertex_count_; ix++)
+  {
+    double side = cross(ix, (ix + 1) % vertex_count_, x, y);
+    visible[ix] = (side <= 0.0);
+    if (side < 0.0)
+      outside = true;
+  }
+
+  if (outside == false)
+    return true;
+
+  int run_start = 0;
+  while (run_start < vertex_count_
+      && (visible[run_start] == false || visible[(run_start + vertex_count_ - 1) % vertex_count_] == true))
+    run_start++;
+
+  // every edge sees the point only for a degenerate hull
+  if (run_start == vertex_count_)
+    return false;
+
+  int run_length = 1;
+  while (visible[(run_start + run_length) % vertex_count_] == true)
+    run_length++;
+
+  int new_count = vertex_count_ - run_length + 2;
+  if (new_count > SUPPORT_POLYGON_MAX_VERTEX)
+    return false;
+
+  // from the vertex after the run around to the vertex where the run starts, then the point
+  double new_x[SUPPORT_POLYGON_MAX_VERTEX], new_y[SUPPORT_POLYGON_MAX_VERTEX];
+  for (int ix = 0; ix < new_count - 1; ix++)
+  {
+    int vertex = (run_start + run_length + ix) % vertex_count_;
+    new_x[ix] = vertex_x_[vertex];
+    new_y[ix] = vertex_y_[vertex];
+  }
+  new_x[new_count - 1] = x;
+  new_y[new_count - 1] = y;
+
+  for (int ix = 0; ix < new_count; ix++)
+  {
+    vertex_x_[ix] = new_x[ix];
+    vertex_y_[ix] = new_y[ix];
+  }
+  vertex_count_ = new_count;
+
+  return true;
+}
+
+bool SupportPolygon::addFoot(const Eigen::Vector3d &position, const Eigen::Matrix3d &orientation, double size_x,
+                             double size_y)
+{
+  // heading of the sole on the ground
+  double heading_x = orientation.coeff(0, 0), heading_y = orientation.coeff(1, 0);
+  double heading_norm = sqrt(heading_x * heading_x + heading_y * heading_y);
+  if (heading_norm < 1e-9)
+  {
+    heading_x = 1.0;
+    heading_y = 0.0;
+  }
+  else
+  {
+    heading_x /= heading_norm;
+    heading_y /= heading_norm;
+  }
+
+  double half_x = 0.5 * size_x, half_y = 0.5 * size_y;
+  double corner_sign[4][2] = { { 1.0, 1.0 }, { -1.0, 1.0 }, { -1.0, -1.0 }, { 1.0, -1.0 } };
+  bool result = true;
+
+  for (int ix = 0; ix < 4; ix++)
+  {
+    double local_x = corner_sign[ix][0] * half_x, local_y = corner_sign[ix][1] * half_y;
+
+    if (addPoint(position.coeff(0) + heading_x * local_x - heading_y * local_y,
+                 position.coeff(1) + heading_y * local_x + heading_x * local_y) == false)
+      result = false;
+  }
+
+  return result;
+}
+
+int SupportPolygon::getVertexCount() const
+{
+  return vertex_count_;
+}
+
+Eigen::Vector2d SupportPolygon::getVertex(int index) const
+{
+  return Eigen::Vector2d(vertex_x_[index], vertex_y_[index]);
+}
+
+int SupportPolygon::calcEdgeDistance(double x, double y, double *distance) const
+{
+  if (vertex_count_ < 3)
+    return 0;
+
+  for (int ix = 0; ix < vertex_count_; ix++)
+  {
+    int next = (ix + 1) % vertex_count_;
+    double dx = vertex_x_[next] - vertex_x_[ix], dy = vertex_y_[next] - vertex_y_[ix];
+
+    distance[ix] = cross(ix, next, x, y) / sqrt(dx * dx + dy * dy);
+  }
+
+  return vertex_count_;
+}
+
+double SupportPolygon::calcMargin(double x, double y) const
+{
+  double distance[SUPPORT_POLYGON_MAX_VERTEX];
+  int edge_count = calcEdgeDistance(x, y, distance);
+  if (edge_count == 0)
+    return -DBL_MAX;
+
+  double margin = distance[0];
+  for (int ix = 1; ix < edge_count; ix++)
+    margin = std::min(margin, distance[ix]);
+
+  // inside a convex polygon the nearest edge line is the nearest boundary
+  if (margin >= 0.0)
+    return margin;
+
+  // outside, the nearest point of the boundary may be a vertex
+  double nearest = DBL_MAX;
+  for (int ix = 0; ix < edge_count; ix++)
+  {
+    int next = (ix + 1) % edge_count;
+    double dx = vertex_x_[next] - vertex_x_[ix], dy = vertex_y_[next] - vertex_y_[ix];
+    double t = (dx * (x - vertex_x_[ix]) + dy * (y - vertex_y_[ix])) / (dx * dx + dy * dy);
+    t = std::max(0.0, std::min(1.0, t));
+
+    double ex = x - (vertex_x_[ix] + t * dx), ey = y - (vertex_y_[ix] + t * dy);
+    nearest = std::min(nearest, ex * ex + ey * ey);
+  }
+
+  return -sqrt(nearest);
+}
+
+bool SupportPolygon::isInside(double x, double y) const
+{
+  if (vertex_count_ < 3)
+    return false;
+
+  for (int ix = 0; ix < vertex_count_; ix++)
+  {
+    if (cross(ix, (ix + 1) % vertex_count_, x, y) < 0.0)
+      return false;
+  }
+
+  return true;
+}
+
+}
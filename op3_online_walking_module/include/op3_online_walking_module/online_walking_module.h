@@ -39,6 +39,7 @@
 #include "wholebody_control.h"
 #include "walking_control.h"
 #include "op3_kdl.h"
+#include "preview_matrix.h"
 
 #include "robotis_controller_msgs/JointCtrlModule.h"
 #include "robotis_controller_msgs/StatusMsg.h"
@@ -129,6 +130,8 @@ public:
   WalkingControl    *walking_control_;
 
   OP3Kinematics *op3_kdl_;
+  // preview gains are memoized here across walking starts
+  robotis_op::OP3KinematicsDynamics *op3_kd_;
 
 private:
   void queueThread();
@@ -230,6 +233,8 @@ private:
   std::vector<double_t> preview_response_P_;
   int preview_response_P_row_, preview_response_P_col_;
 
+  PreviewMatrix preview_matrix_;
+
   // Wholebody Control
   geometry_msgs::Pose wholebody_goal_msg_;
 
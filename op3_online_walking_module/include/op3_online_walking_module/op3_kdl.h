@@ -41,17 +41,25 @@
 #include <kdl/chainiksolvervel_pinv.hpp>
 #include <kdl/chainiksolverpos_nr_jl.hpp>
 
+#include "op3_kinematics_dynamics/op3_kinematics_dynamics.h"
+
 #define LEG_JOINT_NUM   (6)
 #define D2R             (M_PI/180.0)
 
+enum IK_SOLVER_TYPE
+{
+  KDL_SOLVER,
+  ANALYTIC_SOLVER
+};
+
 class OP3Kinematics
 {
 public:
   OP3Kinematics();
   virtual ~OP3Kinematics();
 
-//  void initialize(std::vector<double_t> pelvis_position, std::vector<double_t> pelvis_orientation);
-  void initialize(Eigen::MatrixXd pelvis_position, Eigen::MatrixXd pelvis_orientation);
+  void initialize();
+  void setPelvisPose(Eigen::MatrixXd pelvis_position, Eigen::MatrixXd pelvis_orientation);
   void setJointPosition(Eigen::VectorXd rleg_joint_position, Eigen::VectorXd lleg_joint_position);
   void solveForwardKinematics(std::vector<double_t> &rleg_position, std::vector<double_t> &rleg_orientation,
                               std::vector<double_t> &lleg_position, std::vector<double_t> &lleg_orientation);
@@ -59,17 +67,32 @@ public:
                               Eigen::MatrixXd rleg_target_position, Eigen::Quaterniond rleg_target_orientation,
                               std::vector<double_t> &lleg_output,
                               Eigen::MatrixXd lleg_target_position, Eigen::Quaterniond lleg_target_orientation);
+  // targets are expressed in the pelvis frame
+  bool solveAnalyticInverseKinematics(std::vector<double_t> &rleg_output,
+                                      Eigen::MatrixXd rleg_target_position, Eigen::Quaterniond rleg_target_orientation,
+                                      std::vector<double_t> &lleg_output,
+                                      Eigen::MatrixXd lleg_target_position, Eigen::Quaterniond lleg_target_orientation);
+  void setInverseKinematicsSolver(IK_SOLVER_TYPE ik_solver_type);
   void finalize();
 
 protected:
-//  KDL::Chain rleg_chain_;
+  bool solveAnalyticInverseKinematics(std::vector<double_t> &rleg_output, const KDL::Frame &rleg_desired_pose,
+                                      std::vector<double_t> &lleg_output, const KDL::Frame &lleg_desired_pose);
+  bool solveAnalyticLegInverseKinematics(const robotis_op::LegIKParameter &leg_param, const KDL::Vector &hip_position,
+                                         const KDL::Frame &desired_pose, double *output);
+  // closed-form leg parameters from the segments of a leg chain, joint limits from op3_kd_
+  robotis_op::LegIKParameter getLegIKParameter(const KDL::Chain &leg_chain, int leg_start_id);
+  // FK(IK(FK(q))) == FK(q) on a few poses of both chains
+  bool checkAnalyticInverseKinematics();
+
+  KDL::Chain rleg_chain_;
   KDL::ChainDynParam *rleg_dyn_param_ = NULL;
   KDL::ChainJntToJacSolver *rleg_jacobian_solver_;
   KDL::ChainFkSolverPos_recursive *rleg_fk_solver_;
   KDL::ChainIkSolverVel_pinv *rleg_ik_vel_solver_;
   KDL::ChainIkSolverPos_NR_JL *rleg_ik_pos_solver_;
 
-//  KDL::Chain lleg_chain_;
+  KDL::Chain lleg_chain_;
   KDL::ChainDynParam *lleg_dyn_param_ = NULL;
   KDL::ChainJntToJacSolver *lleg_jacobian_solver_;
   KDL::ChainFkSolverPos_recursive *lleg_fk_solver_;
@@ -83,6 +106,15 @@ protected:
   geometry_msgs::Pose rleg_pose_, lleg_pose_;
   geometry_msgs::Pose rleg_ft_pose_, lleg_ft_pose_;
 
+  KDL::Frame pelvis_frame_;
+
+  // closed-form leg ik (pelvis frame -> hip yaw/roll center), on the same geometry as the kdl chains
+  IK_SOLVER_TYPE ik_solver_type_;
+  bool analytic_ik_valid_;
+  robotis_op::OP3KinematicsDynamics *op3_kd_;
+  KDL::Vector rleg_hip_position_, lleg_hip_position_;
+  robotis_op::LegIKParameter rleg_ik_param_, lleg_ik_param_;
+
 
 
 
@@ -0,0 +1,74 @@
+/*******************************************************************************
+* Copyright 2017 ROBOTIS CO., LTD.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+/* Author: SCH */
+
+#ifndef OP3_ONLINE_WALKING_MODULE_PREVIEW_MATRIX_
+#define OP3_ONLINE_WALKING_MODULE_PREVIEW_MATRIX_
+
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <math.h>
+#include <eigen3/Eigen/Eigen>
+
+// Preview control gain of the LIPM (cart-table) model with integral action.
+// K (1x4) and P (4x4) are the solution of the discrete algebraic riccati equation
+// for state [sum of zmp error, com, com vel, com accel].
+class PreviewMatrix
+{
+public:
+  PreviewMatrix();
+  virtual ~PreviewMatrix();
+
+  void setWeight(double q_e, double q_x, double r);
+  void setCacheFile(const std::string &path);
+
+  // K and P are stored column-major (same layout as PreviewResponse)
+  bool calcPreviewMatrix(double lipm_height, double control_cycle,
+                         std::vector<double_t> &K, std::vector<double_t> &P);
+
+  // tabulated K and P of the default weights for lipm height 0.12 m and control cycle 8 ms
+  static void getDefaultPreviewMatrix(std::vector<double_t> &K, std::vector<double_t> &P);
+  // solves the default case and compares it with the table, relative to each entry
+  static bool checkDefaultPreviewMatrix(double tolerance = 1e-6);
+
+protected:
+  struct PreviewMatrixData
+  {
+    double lipm_height;
+    double control_cycle;
+    double q_e, q_x, r;
+    double K[4];
+    double P[16];
+  };
+
+  bool solveRiccatiEquation(double lipm_height, double control_cycle, PreviewMatrixData &data);
+  bool findCache(double lipm_height, double control_cycle, PreviewMatrixData &data);
+
+  bool loadCacheFile();
+  bool saveCacheFile();
+
+  double q_e_, q_x_, r_;
+
+  std::string cache_path_;
+  bool cache_loaded_;
+  std::vector<PreviewMatrixData> cache_;
+};
+
+#endif
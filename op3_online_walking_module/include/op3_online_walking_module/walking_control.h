@@ -33,7 +33,7 @@
 #include "op3_online_walking_module_msgs/PreviewResponse.h"
 #include "op3_online_walking_module_msgs/Step2D.h"
 #include "op3_online_walking_module_msgs/Step2DArray.h"
-//#include "op3_kinematics_dynamics/op3_kinematics_dynamics.h"
+#include "op3_kinematics_dynamics/op3_kinematics_dynamics.h"
 #include "robotis_math/robotis_math.h"
 
 enum WALKING_LEG {
@@ -54,7 +54,8 @@ public:
   WalkingControl(double control_cycle,
                  double dsp_ratio, double lipm_height, double foot_height_max, double zmp_offset_x, double zmp_offset_y,
                  std::vector<double_t> x_lipm, std::vector<double_t> y_lipm,
-                 double foot_distance);
+                 double foot_distance,
+                 robotis_op::OP3KinematicsDynamics *op3_kd);
   virtual ~WalkingControl();
 
   void initialize(op3_online_walking_module_msgs::FootStepCommand foot_step_command,
@@ -81,6 +82,7 @@ public:
   void calcPreviewParam(std::vector<double_t> K, int K_row, int K_col,
                         std::vector<double_t> P, int P_row, int P_col);
   void calcPreviewControl(double time, int step);
+  void updatePreviewRefZMP(int preview_index);
 
   void calcGoalFootPose();
 
@@ -109,7 +111,8 @@ protected:
   robotis_framework::MinimumJerkViaPoint *r_foot_tra_;
   robotis_framework::MinimumJerkViaPoint *l_foot_tra_;
 
-  robotis_framework::PreviewControl *preview_control_;
+  // not owned, keeps the preview gains of earlier walking starts
+  robotis_op::OP3KinematicsDynamics *op3_kd_;
 
   double init_time_, fin_time_;
   double control_cycle_;
@@ -142,7 +145,7 @@ protected:
   Eigen::MatrixXd A_, b_, c_;
   Eigen::MatrixXd k_x_;
   double k_s_;
-  Eigen::MatrixXd f_;
+  Eigen::VectorXd f_;  // preview gain, contiguous so the dot with the reference zmp is vectorized
   Eigen::MatrixXd u_x_, u_y_;
   Eigen::MatrixXd x_lipm_, y_lipm_;
 
@@ -155,6 +158,13 @@ protected:
   Eigen::MatrixXd goal_r_foot_pos_buffer_, goal_l_foot_pos_buffer_;
   Eigen::MatrixXd ref_zmp_buffer_;
 
+  // Preview Reference ZMP (ring buffer over the preview horizon,
+  // every sample is stored twice so the horizon is always contiguous)
+  Eigen::VectorXd preview_ref_zmp_x_, preview_ref_zmp_y_;
+  int preview_ref_zmp_head_;
+  int preview_ref_zmp_index_;
+  bool preview_ref_zmp_update_;
+
   // Pose Information
   double init_body_yaw_angle_;
 
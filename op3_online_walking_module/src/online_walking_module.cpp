@@ -16,6 +16,7 @@
 
 /* Author: SCH */
 
+#include <stdlib.h>
 #include "op3_online_walking_module/online_walking_module.h"
 
 using namespace robotis_op;
@@ -43,6 +44,7 @@ OnlineWalkingModule::OnlineWalkingModule()
   balance_type_ = OFF;
 
   op3_kdl_ = new OP3Kinematics();
+  op3_kd_ = new robotis_op::OP3KinematicsDynamics(robotis_op::WholeBody);
 
   /* leg */
   result_["r_hip_yaw"]    = new robotis_framework::DynamixelState();
@@ -157,11 +159,25 @@ OnlineWalkingModule::OnlineWalkingModule()
 
   std::string joint_feedforward_gain_path = ros::package::getPath("op3_online_walking_module") + "/config/joint_feedforward_gain.yaml";
   parseJointFeedforwardGainData(joint_feedforward_gain_path);
+
+  // solved preview matrices are kept in ROS_HOME (~/.ros by default), the package share directory may be read-only
+  const char *ros_home = getenv("ROS_HOME");
+  const char *home = getenv("HOME");
+  if (ros_home != NULL)
+    preview_matrix_.setCacheFile(std::string(ros_home) + "/op3_online_walking_preview_matrix.bin");
+  else if (home != NULL)
+    preview_matrix_.setCacheFile(std::string(home) + "/.ros/op3_online_walking_preview_matrix.bin");
+
+  if (PreviewMatrix::checkDefaultPreviewMatrix() == false)
+    ROS_WARN("[WARN] solved preview matrix does not match the default preview matrix");
 }
 
 OnlineWalkingModule::~OnlineWalkingModule()
 {
   queue_thread_.join();
+
+  delete op3_kdl_;
+  delete op3_kd_;
 }
 
 void OnlineWalkingModule::initialize(const int control_cycle_msec, robotis_framework::Robot *robot)
@@ -1007,7 +1023,8 @@ void OnlineWalkingModule::initWalkingControl()
                                         walking_param_.dsp_ratio, walking_param_.lipm_height, walking_param_.foot_height_max,
                                         walking_param_.zmp_offset_x, walking_param_.zmp_offset_y,
                                         x_lipm_, y_lipm_,
-                                        foot_distance_);
+                                        foot_distance_,
+                                        op3_kd_);
 
   double lipm_height = walking_control_->getLipmHeight();
   preview_request_.lipm_height = lipm_height;
@@ -1134,7 +1151,7 @@ void OnlineWalkingModule::calcRobotPose()
   Eigen::MatrixXd des_body_rot = robotis_framework::convertQuaternionToRotation(des_body_Q);
 
   // Forward Kinematics
-  op3_kdl_->initialize(des_body_pos, des_body_rot);
+  op3_kdl_->setPelvisPose(des_body_pos, des_body_rot);
 
   Eigen::VectorXd r_leg_joint_pos, l_leg_joint_pos;
 
@@ -1184,8 +1201,6 @@ void OnlineWalkingModule::calcRobotPose()
   g_to_l_leg.coeffRef(0,3) = l_leg_pos[0];
   g_to_l_leg.coeffRef(1,3) = l_leg_pos[1];
   g_to_l_leg.coeffRef(2,3) = l_leg_pos[2];
-
-  op3_kdl_->finalize();
 }
 
 void OnlineWalkingModule::setTargetForceTorque()
@@ -1411,7 +1426,7 @@ bool OnlineWalkingModule::setBalanceControl()
   Eigen::MatrixXd des_l_foot_pos_mod = l_foot_pose_mod.block<3,1>(0,3);
 
   // ======= ======= //
-  op3_kdl_->initialize(des_body_pos_mod, des_body_rot_mod);
+  op3_kdl_->setPelvisPose(des_body_pos_mod, des_body_rot_mod);
 
   Eigen::VectorXd r_leg_joint_pos, l_leg_joint_pos;
 
@@ -1443,8 +1458,6 @@ bool OnlineWalkingModule::setBalanceControl()
                                                 l_leg_output,
                                                 des_l_foot_pos_mod,des_l_foot_Q_mod);
 
-  op3_kdl_->finalize();
-
   if (ik_success == true)
   {
     des_joint_pos_[joint_name_to_id_["r_hip_yaw"]-1]      = r_leg_output[0];
@@ -1784,34 +1797,19 @@ bool OnlineWalkingModule::getKinematicsPoseCallback(op3_online_walking_module_ms
 
 bool OnlineWalkingModule::definePreviewMatrix()
 {
-  std::vector<double_t> K;
-  K.push_back(739.200064);
-  K.push_back(24489.822984);
-  K.push_back(3340.410380);
-  K.push_back(69.798325);
+  std::vector<double_t> K, P;
+
+  if (preview_matrix_.calcPreviewMatrix(preview_request_.lipm_height, preview_request_.control_cycle, K, P) == false)
+  {
+    ROS_WARN("[WARN] Riccati equation is not solved, use default preview matrix");
+
+    PreviewMatrix::getDefaultPreviewMatrix(K, P);
+  }
 
   preview_response_K_ = K;
   preview_response_K_row_ = 1;
   preview_response_K_col_ = 4;
 
-  std::vector<double_t> P;
-  P.push_back(33.130169);
-  P.push_back(531.738962);
-  P.push_back(60.201291);
-  P.push_back(0.327533);
-  P.push_back(531.738962);
-  P.push_back(10092.440286);
-  P.push_back(1108.851055);
-  P.push_back(7.388990);
-  P.push_back(60.201291);
-  P.push_back(1108.851055);
-  P.push_back(130.194694);
-  P.push_back(0.922502);
-  P.push_back(0.327533);
-  P.push_back(7.388990);
-  P.push_back(0.922502);
-  P.push_back(0.012336);
-
   preview_response_P_ = P;
   preview_response_P_row_ = 4;
   preview_response_P_col_ = 4;
@@ -20,213 +20,204 @@
 #include "op3_online_walking_module/op3_kdl.h"
 
 OP3Kinematics::OP3Kinematics()
+  : rleg_fk_solver_(NULL),
+    rleg_ik_vel_solver_(NULL),
+    rleg_ik_pos_solver_(NULL),
+    lleg_fk_solver_(NULL),
+    lleg_ik_vel_solver_(NULL),
+    lleg_ik_pos_solver_(NULL),
+    ik_solver_type_(ANALYTIC_SOLVER),
+    analytic_ik_valid_(false)
 {
   rleg_joint_position_.resize(LEG_JOINT_NUM);
+  lleg_joint_position_.resize(LEG_JOINT_NUM);
 
   for (int i=0; i<LEG_JOINT_NUM; i++)
+  {
     rleg_joint_position_(i) = 0.0;
+    lleg_joint_position_(i) = 0.0;
+  }
+
+  pelvis_frame_ = KDL::Frame::Identity();
+
+  op3_kd_ = new robotis_op::OP3KinematicsDynamics(robotis_op::WholeBody);
+
+  initialize();
+
+  // once, the chains are the same every time initialize() builds them
+  analytic_ik_valid_ = checkAnalyticInverseKinematics();
+  if (analytic_ik_valid_ == false)
+  {
+    ROS_WARN("closed-form leg IK does not match the KDL chain, use KDL solver");
+    ik_solver_type_ = KDL_SOLVER;
+  }
 }
 
 OP3Kinematics::~OP3Kinematics()
 {
+  finalize();
 
+  delete op3_kd_;
 }
 
-void OP3Kinematics::initialize(Eigen::MatrixXd pelvis_position, Eigen::MatrixXd pelvis_orientation)
+void OP3Kinematics::initialize()
 {
-  KDL::Chain rleg_chain, lleg_chain;
-
-  double pelvis_x = pelvis_position.coeff(0,0);
-  double pelvis_y = pelvis_position.coeff(1,0);
-  double pelvis_z = pelvis_position.coeff(2,0);
-
-  double pelvis_Xx = pelvis_orientation.coeff(0,0);
-  double pelvis_Yx = pelvis_orientation.coeff(0,1);
-  double pelvis_Zx = pelvis_orientation.coeff(0,2);
-
-  double pelvis_Xy = pelvis_orientation.coeff(1,0);
-  double pelvis_Yy = pelvis_orientation.coeff(1,1);
-  double pelvis_Zy = pelvis_orientation.coeff(1,2);
+  // chains and solvers are built once and reused every tick,
+  // the floating base is applied through pelvis_frame_ (see setPelvisPose)
+  if (rleg_ik_pos_solver_ != NULL && lleg_ik_pos_solver_ != NULL)
+    return;
 
-  double pelvis_Xz = pelvis_orientation.coeff(2,0);
-  double pelvis_Yz = pelvis_orientation.coeff(2,1);
-  double pelvis_Zz = pelvis_orientation.coeff(2,2);
-
-  // Set Kinematics Tree
+  // Set Kinematics Tree (expressed in pelvis frame)
 
   // Right Leg Chain
-  rleg_chain.addSegment(KDL::Segment("base",
-                                     KDL::Joint(KDL::Joint::None),
-                                     KDL::Frame(KDL::Rotation(pelvis_Xx, pelvis_Yx, pelvis_Zx,
-                                                              pelvis_Xy, pelvis_Yy, pelvis_Zy,
-                                                              pelvis_Xz, pelvis_Yz, pelvis_Zz),
-                                                KDL::Vector(pelvis_x , pelvis_y , pelvis_z)),
-                                     KDL::RigidBodyInertia(0.0,
-                                                           KDL::Vector(0.0, 0.0, 0.0),
-                                                           KDL::RotationalInertia(0.0, 0.0, 0.0, 0.0, 0.0, 0.0)
-                                                           )
-                                     )
-                        );
-  rleg_chain.addSegment(KDL::Segment("pelvis",
-                                     KDL::Joint(KDL::Joint::None),
-                                     KDL::Frame(KDL::Vector(0.0, -0.035, -0.0907)),
-//                                     KDL::Frame(KDL::Vector(-0.005, -0.035, -0.0907)),
-                                     KDL::RigidBodyInertia(0.72235,
-                                                           KDL::Vector(0.0, 0.0, 0.0),
-                                                           KDL::RotationalInertia(0.0, 0.0, 0.0, 0.0, 0.0, 0.0)
-                                                           )
-                                     )
-                        );
-  rleg_chain.addSegment(KDL::Segment("r_hip_yaw",
-                                     KDL::Joint("minus_RotZ", KDL::Vector(0,0,0), KDL::Vector(0,0,-1), KDL::Joint::RotAxis),
-                                     KDL::Frame(KDL::Vector(0.000, 0.000, -0.0285)),
-                                     KDL::RigidBodyInertia(0.01181,
-                                                           KDL::Vector(0.0, 0.0, 0.0),
-                                                           KDL::RotationalInertia(0.0, 0.0, 0.0, 0.0, 0.0, 0.0)
-                                                           )
-                                     )
-                        );
-  rleg_chain.addSegment(KDL::Segment("r_leg_hip_r",
-                                     KDL::Joint("minus_RotX", KDL::Vector(0,0,0), KDL::Vector(-1,0,0), KDL::Joint::RotAxis),
-                                     KDL::Frame(KDL::Vector(0.0, 0.0, 0.0)),
-                                     KDL::RigidBodyInertia(0.17886,
-                                                           KDL::Vector(0.0, 0.0, 0.0),
-                                                           KDL::RotationalInertia(0.0, 0.0, 0.0, 0.0, 0.0, 0.0)
-                                                           )
-                                     )
-                        );
-  rleg_chain.addSegment(KDL::Segment("r_leg_hip_p",
-                                     KDL::Joint("minus_RotY", KDL::Vector(0,0,0), KDL::Vector(0,-1,0), KDL::Joint::RotAxis),
-                                     KDL::Frame(KDL::Vector(0.0, 0.0, -0.11)),
-                                     KDL::RigidBodyInertia(0.11543,
-                                                           KDL::Vector(0.0, 0.0, 0.0),
-                                                           KDL::RotationalInertia(0.0, 0.0, 0.0, 0.0, 0.0, 0.0)
-                                                           )
-                                     )
-                        );
-  rleg_chain.addSegment(KDL::Segment("r_leg_kn_p",
-                                     KDL::Joint("minus_RotY", KDL::Vector(0,0,0), KDL::Vector(0,-1,0), KDL::Joint::RotAxis),
-                                     KDL::Frame(KDL::Vector(0.0, 0.0, -0.11)),
-                                     KDL::RigidBodyInertia(0.04015,
-                                                           KDL::Vector(0.0, 0.0, 0.0),
-                                                           KDL::RotationalInertia(0.0, 0.0, 0.0, 0.0, 0.0, 0.0)
-                                                           )
-                                     )
-                        );
-  rleg_chain.addSegment(KDL::Segment("r_leg_an_p",
-                                     KDL::Joint(KDL::Joint::RotY),
-                                     KDL::Frame(KDL::Vector(0.0, 0.0, 0.0)),
-                                     KDL::RigidBodyInertia(0.17886,
-                                                           KDL::Vector(0.0, 0.0, 0.0),
-                                                           KDL::RotationalInertia(0.0, 0.0, 0.0, 0.0, 0.0, 0.0)
-                                                           )
-                                     )
-                        );
-  rleg_chain.addSegment(KDL::Segment("r_leg_an_r",
-                                     KDL::Joint(KDL::Joint::RotX),
-                                     KDL::Frame(KDL::Vector(0.0, 0.0, -0.0305)),
-                                     KDL::RigidBodyInertia(0.06934,
-                                                           KDL::Vector(0.0, 0.0, 0.0),
-                                                           KDL::RotationalInertia(0.0, 0.0, 0.0, 0.0, 0.0, 0.0)
-                                                           )
-                                     )
-                        );
-  rleg_chain.addSegment(KDL::Segment("r_leg_end",
-                                     KDL::Joint(KDL::Joint::None),
-                                     KDL::Frame(KDL::Vector(0.0 , 0.0 , 0.0)),
-                                     KDL::RigidBodyInertia(0.0,
-                                                           KDL::Vector(0.0, 0.0, 0.0),
-                                                           KDL::RotationalInertia(0.0, 0.0, 0.0, 0.0, 0.0, 0.0)
-                                                           )
-                                     )
-                        );
+  rleg_chain_.addSegment(KDL::Segment("pelvis",
+                                      KDL::Joint(KDL::Joint::None),
+                                      KDL::Frame(KDL::Vector(0.0, -0.035, -0.0907)),
+//                                      KDL::Frame(KDL::Vector(-0.005, -0.035, -0.0907)),
+                                      KDL::RigidBodyInertia(0.72235,
+                                                            KDL::Vector(0.0, 0.0, 0.0),
+                                                            KDL::RotationalInertia(0.0, 0.0, 0.0, 0.0, 0.0, 0.0)
+                                                            )
+                                      )
+                         );
+  rleg_chain_.addSegment(KDL::Segment("r_hip_yaw",
+                                      KDL::Joint("minus_RotZ", KDL::Vector(0,0,0), KDL::Vector(0,0,-1), KDL::Joint::RotAxis),
+                                      KDL::Frame(KDL::Vector(0.000, 0.000, -0.0285)),
+                                      KDL::RigidBodyInertia(0.01181,
+                                                            KDL::Vector(0.0, 0.0, 0.0),
+                                                            KDL::RotationalInertia(0.0, 0.0, 0.0, 0.0, 0.0, 0.0)
+                                                            )
+                                      )
+                         );
+  rleg_chain_.addSegment(KDL::Segment("r_leg_hip_r",
+                                      KDL::Joint("minus_RotX", KDL::Vector(0,0,0), KDL::Vector(-1,0,0), KDL::Joint::RotAxis),
+                                      KDL::Frame(KDL::Vector(0.0, 0.0, 0.0)),
+                                      KDL::RigidBodyInertia(0.17886,
+                                                            KDL::Vector(0.0, 0.0, 0.0),
+                                                            KDL::RotationalInertia(0.0, 0.0, 0.0, 0.0, 0.0, 0.0)
+                                                            )
+                                      )
+                         );
+  rleg_chain_.addSegment(KDL::Segment("r_leg_hip_p",
+                                      KDL::Joint("minus_RotY", KDL::Vector(0,0,0), KDL::Vector(0,-1,0), KDL::Joint::RotAxis),
+                                      KDL::Frame(KDL::Vector(0.0, 0.0, -0.11)),
+                                      KDL::RigidBodyInertia(0.11543,
+                                                            KDL::Vector(0.0, 0.0, 0.0),
+                                                            KDL::RotationalInertia(0.0, 0.0, 0.0, 0.0, 0.0, 0.0)
+                                                            )
+                                      )
+                         );
+  rleg_chain_.addSegment(KDL::Segment("r_leg_kn_p",
+                                      KDL::Joint("minus_RotY", KDL::Vector(0,0,0), KDL::Vector(0,-1,0), KDL::Joint::RotAxis),
+                                      KDL::Frame(KDL::Vector(0.0, 0.0, -0.11)),
+                                      KDL::RigidBodyInertia(0.04015,
+                                                            KDL::Vector(0.0, 0.0, 0.0),
+                                                            KDL::RotationalInertia(0.0, 0.0, 0.0, 0.0, 0.0, 0.0)
+                                                            )
+                                      )
+                         );
+  rleg_chain_.addSegment(KDL::Segment("r_leg_an_p",
+                                      KDL::Joint(KDL::Joint::RotY),
+                                      KDL::Frame(KDL::Vector(0.0, 0.0, 0.0)),
+                                      KDL::RigidBodyInertia(0.17886,
+                                                            KDL::Vector(0.0, 0.0, 0.0),
+                                                            KDL::RotationalInertia(0.0, 0.0, 0.0, 0.0, 0.0, 0.0)
+                                                            )
+                                      )
+                         );
+  rleg_chain_.addSegment(KDL::Segment("r_leg_an_r",
+                                      KDL::Joint(KDL::Joint::RotX),
+                                      KDL::Frame(KDL::Vector(0.0, 0.0, -0.0305)),
+                                      KDL::RigidBodyInertia(0.06934,
+                                                            KDL::Vector(0.0, 0.0, 0.0),
+                                                            KDL::RotationalInertia(0.0, 0.0, 0.0, 0.0, 0.0, 0.0)
+                                                            )
+                                      )
+                         );
+  rleg_chain_.addSegment(KDL::Segment("r_leg_end",
+                                      KDL::Joint(KDL::Joint::None),
+                                      KDL::Frame(KDL::Vector(0.0 , 0.0 , 0.0)),
+                                      KDL::RigidBodyInertia(0.0,
+                                                            KDL::Vector(0.0, 0.0, 0.0),
+                                                            KDL::RotationalInertia(0.0, 0.0, 0.0, 0.0, 0.0, 0.0)
+                                                            )
+                                      )
+                         );
 
   // Left Leg Chain
-  lleg_chain.addSegment(KDL::Segment("base",
-                                     KDL::Joint(KDL::Joint::None),
-                                     KDL::Frame(KDL::Rotation(pelvis_Xx, pelvis_Yx, pelvis_Zx,
-                                                              pelvis_Xy, pelvis_Yy, pelvis_Zy,
-                                                              pelvis_Xz, pelvis_Yz, pelvis_Zz),
-                                                KDL::Vector(pelvis_x , pelvis_y , pelvis_z)),
-                                     KDL::RigidBodyInertia(0.0,
-                                                           KDL::Vector(0.0, 0.0, 0.0),
-                                                           KDL::RotationalInertia(0.0, 0.0, 0.0, 0.0, 0.0, 0.0)
-                                                           )
-                                     )
-                        );
-  lleg_chain.addSegment(KDL::Segment("pelvis",
-                                     KDL::Joint(KDL::Joint::None),
-                                     KDL::Frame(KDL::Vector(0.0, 0.035, -0.0907)),
-//                                     KDL::Frame(KDL::Vector(-0.005, 0.035, -0.0907)),
-                                     KDL::RigidBodyInertia(0.72235,
-                                                           KDL::Vector(0.0, 0.0, 0.0),
-                                                           KDL::RotationalInertia(0.0, 0.0, 0.0, 0.0, 0.0, 0.0)
-                                                           )
-                                     )
-                        );
-  lleg_chain.addSegment(KDL::Segment("l_leg_hip_y",
-                                     KDL::Joint("minus_RotZ", KDL::Vector(0,0,0), KDL::Vector(0,0,-1), KDL::Joint::RotAxis),
-                                     KDL::Frame(KDL::Vector(0.000, 0.000, -0.0285)),
-                                     KDL::RigidBodyInertia(0.01181,
-                                                           KDL::Vector(0.0, 0.0, 0.0),
-                                                           KDL::RotationalInertia(0.0, 0.0, 0.0, 0.0, 0.0, 0.0)
-                                                           )
-                                     )
-                        );
-  lleg_chain.addSegment(KDL::Segment("l_leg_hip_r",
-                                     KDL::Joint("minus_RotX", KDL::Vector(0,0,0), KDL::Vector(-1,0,0), KDL::Joint::RotAxis),
-                                     KDL::Frame(KDL::Vector(0.0, 0.0, 0.0)),
-                                     KDL::RigidBodyInertia(0.17886,
-                                                           KDL::Vector(0.0, 0.0, 0.0),
-                                                           KDL::RotationalInertia(0.0, 0.0, 0.0, 0.0, 0.0, 0.0)
-                                                           )
-                                     )
-                        );
-  lleg_chain.addSegment(KDL::Segment("l_leg_hip_p",
-                                     KDL::Joint(KDL::Joint::RotY),
-                                     KDL::Frame(KDL::Vector(0.0, 0.0, -0.11)),
-                                     KDL::RigidBodyInertia(0.11543,
-                                                           KDL::Vector(0.0, 0.0, 0.0),
-                                                           KDL::RotationalInertia(0.0, 0.0, 0.0, 0.0, 0.0, 0.0)
-                                                           )
-                                     )
-                        );
-  lleg_chain.addSegment(KDL::Segment("l_leg_kn_p",
-                                     KDL::Joint(KDL::Joint::RotY),
-                                     KDL::Frame(KDL::Vector(0.0, 0.0, -0.11)),
-                                     KDL::RigidBodyInertia(0.04015,
-                                                           KDL::Vector(0.0, 0.0, 0.0),
-                                                           KDL::RotationalInertia(0.0, 0.0, 0.0, 0.0, 0.0, 0.0)
-                                                           )
-                                     )
-                        );
-  lleg_chain.addSegment(KDL::Segment("l_leg_an_p",
-                                     KDL::Joint("minus_RotY", KDL::Vector(0,0,0), KDL::Vector(0,-1,0), KDL::Joint::RotAxis),
-                                     KDL::Frame(KDL::Vector(0.0, 0.0, 0.0)),
-                                     KDL::RigidBodyInertia(0.17886,
-                                                           KDL::Vector(0.0, 0.0, 0.0),
-                                                           KDL::RotationalInertia(0.0, 0.0, 0.0, 0.0, 0.0, 0.0)
-                                                           )
-                                     )
-                        );
-  lleg_chain.addSegment(KDL::Segment("l_leg_an_r",
-                                     KDL::Joint(KDL::Joint::RotX),
-                                     KDL::Frame(KDL::Vector(0.0, 0.0, -0.0305)),
-                                     KDL::RigidBodyInertia(0.06934,
-                                                           KDL::Vector(0.0, 0.0, 0.0),
-                                                           KDL::RotationalInertia(0.0, 0.0, 0.0, 0.0, 0.0, 0.0)
-                                                           )
-                                     )
-                        );
-  lleg_chain.addSegment(KDL::Segment("l_leg_end",
-                                     KDL::Joint(KDL::Joint::None),
-                                     KDL::Frame(KDL::Vector(0.0 , 0.0 , 0.0)),
-                                     KDL::RigidBodyInertia(0.0,
-                                                           KDL::Vector(0.0, 0.0, 0.0),
-                                                           KDL::RotationalInertia(0.0, 0.0, 0.0, 0.0, 0.0, 0.0)
-                                                           )
-                                     )
-                        );
+  lleg_chain_.addSegment(KDL::Segment("pelvis",
+                                      KDL::Joint(KDL::Joint::None),
+                                      KDL::Frame(KDL::Vector(0.0, 0.035, -0.0907)),
+//                                      KDL::Frame(KDL::Vector(-0.005, 0.035, -0.0907)),
+                                      KDL::RigidBodyInertia(0.72235,
+                                                            KDL::Vector(0.0, 0.0, 0.0),
+                                                            KDL::RotationalInertia(0.0, 0.0, 0.0, 0.0, 0.0, 0.0)
+                                                            )
+                                      )
+                         );
+  lleg_chain_.addSegment(KDL::Segment("l_leg_hip_y",
+                                      KDL::Joint("minus_RotZ", KDL::Vector(0,0,0), KDL::Vector(0,0,-1), KDL::Joint::RotAxis),
+                                      KDL::Frame(KDL::Vector(0.000, 0.000, -0.0285)),
+                                      KDL::RigidBodyInertia(0.01181,
+                                                            KDL::Vector(0.0, 0.0, 0.0),
+                                                            KDL::RotationalInertia(0.0, 0.0, 0.0, 0.0, 0.0, 0.0)
+                                                            )
+                                      )
+                         );
+  lleg_chain_.addSegment(KDL::Segment("l_leg_hip_r",
+                                      KDL::Joint("minus_RotX", KDL::Vector(0,0,0), KDL::Vector(-1,0,0), KDL::Joint::RotAxis),
+                                      KDL::Frame(KDL::Vector(0.0, 0.0, 0.0)),
+                                      KDL::RigidBodyInertia(0.17886,
+                                                            KDL::Vector(0.0, 0.0, 0.0),
+                                                            KDL::RotationalInertia(0.0, 0.0, 0.0, 0.0, 0.0, 0.0)
+                                                            )
+                                      )
+                         );
+  lleg_chain_.addSegment(KDL::Segment("l_leg_hip_p",
+                                      KDL::Joint(KDL::Joint::RotY),
+                                      KDL::Frame(KDL::Vector(0.0, 0.0, -0.11)),
+                                      KDL::RigidBodyInertia(0.11543,
+                                                            KDL::Vector(0.0, 0.0, 0.0),
+                                                            KDL::RotationalInertia(0.0, 0.0, 0.0, 0.0, 0.0, 0.0)
+                                                            )
+                                      )
+                         );
+  lleg_chain_.addSegment(KDL::Segment("l_leg_kn_p",
+                                      KDL::Joint(KDL::Joint::RotY),
+                                      KDL::Frame(KDL::Vector(0.0, 0.0, -0.11)),
+                                      KDL::RigidBodyInertia(0.04015,
+                                                            KDL::Vector(0.0, 0.0, 0.0),
+                                                            KDL::RotationalInertia(0.0, 0.0, 0.0, 0.0, 0.0, 0.0)
+                                                            )
+                                      )
+                         );
+  lleg_chain_.addSegment(KDL::Segment("l_leg_an_p",
+                                      KDL::Joint("minus_RotY", KDL::Vector(0,0,0), KDL::Vector(0,-1,0), KDL::Joint::RotAxis),
+                                      KDL::Frame(KDL::Vector(0.0, 0.0, 0.0)),
+                                      KDL::RigidBodyInertia(0.17886,
+                                                            KDL::Vector(0.0, 0.0, 0.0),
+                                                            KDL::RotationalInertia(0.0, 0.0, 0.0, 0.0, 0.0, 0.0)
+                                                            )
+                                      )
+                         );
+  lleg_chain_.addSegment(KDL::Segment("l_leg_an_r",
+                                      KDL::Joint(KDL::Joint::RotX),
+                                      KDL::Frame(KDL::Vector(0.0, 0.0, -0.0305)),
+                                      KDL::RigidBodyInertia(0.06934,
+                                                            KDL::Vector(0.0, 0.0, 0.0),
+                                                            KDL::RotationalInertia(0.0, 0.0, 0.0, 0.0, 0.0, 0.0)
+                                                            )
+                                      )
+                         );
+  lleg_chain_.addSegment(KDL::Segment("l_leg_end",
+                                      KDL::Joint(KDL::Joint::None),
+                                      KDL::Frame(KDL::Vector(0.0 , 0.0 , 0.0)),
+                                      KDL::RigidBodyInertia(0.0,
+                                                            KDL::Vector(0.0, 0.0, 0.0),
+                                                            KDL::RotationalInertia(0.0, 0.0, 0.0, 0.0, 0.0, 0.0)
+                                                            )
+                                      )
+                         );
 
   // Set Joint Limits
   std::vector<double> min_position_limit, max_position_limit;
@@ -247,25 +238,125 @@ void OP3Kinematics::initialize(Eigen::MatrixXd pelvis_position, Eigen::MatrixXd
   /* KDL Solver Initialization */
   //  rleg_dyn_param_ = new KDL::ChainDynParam(rleg_chain_, KDL::Vector(0.0, 0.0, -9.81)); // kinematics & dynamics parameter
   //  rleg_jacobian_solver_ = new KDL::ChainJntToJacSolver(rleg_chain__); // jabocian solver
-  rleg_fk_solver_ = new KDL::ChainFkSolverPos_recursive(rleg_chain); // forward kinematics solver
+  rleg_fk_solver_ = new KDL::ChainFkSolverPos_recursive(rleg_chain_); // forward kinematics solver
 
   // inverse kinematics solver
-  rleg_ik_vel_solver_ = new KDL::ChainIkSolverVel_pinv(rleg_chain);
-  rleg_ik_pos_solver_ = new KDL::ChainIkSolverPos_NR_JL(rleg_chain,
+  rleg_ik_vel_solver_ = new KDL::ChainIkSolverVel_pinv(rleg_chain_);
+  rleg_ik_pos_solver_ = new KDL::ChainIkSolverPos_NR_JL(rleg_chain_,
                                                         min_joint_position_limit, max_joint_position_limit,
                                                         *rleg_fk_solver_,
                                                         *rleg_ik_vel_solver_);
 
   //  lleg_dyn_param_ = new KDL::ChainDynParam(lleg_chain_, KDL::Vector(0.0, 0.0, -9.81)); // kinematics & dynamics parameter
   //  lleg_jacobian_solver_ = new KDL::ChainJntToJacSolver(lleg_chain__); // jabocian solver
-  lleg_fk_solver_ = new KDL::ChainFkSolverPos_recursive(lleg_chain); // forward kinematics solver
+  lleg_fk_solver_ = new KDL::ChainFkSolverPos_recursive(lleg_chain_); // forward kinematics solver
 
   // inverse kinematics solver
-  lleg_ik_vel_solver_ = new KDL::ChainIkSolverVel_pinv(lleg_chain);
-  lleg_ik_pos_solver_ = new KDL::ChainIkSolverPos_NR_JL(lleg_chain,
+  lleg_ik_vel_solver_ = new KDL::ChainIkSolverVel_pinv(lleg_chain_);
+  lleg_ik_pos_solver_ = new KDL::ChainIkSolverPos_NR_JL(lleg_chain_,
                                                         min_joint_position_limit, max_joint_position_limit,
                                                         *lleg_fk_solver_,
                                                         *lleg_ik_vel_solver_);
+
+  // hip yaw and hip roll axes intersect at the tip of the hip yaw segment
+  rleg_hip_position_ = rleg_chain_.getSegment(0).getFrameToTip().p + rleg_chain_.getSegment(1).getFrameToTip().p;
+  lleg_hip_position_ = lleg_chain_.getSegment(0).getFrameToTip().p + lleg_chain_.getSegment(1).getFrameToTip().p;
+
+  rleg_ik_param_ = getLegIKParameter(rleg_chain_, ID_R_LEG_START);
+  lleg_ik_param_ = getLegIKParameter(lleg_chain_, ID_L_LEG_START);
+}
+
+robotis_op::LegIKParameter OP3Kinematics::getLegIKParameter(const KDL::Chain &leg_chain, int leg_start_id)
+{
+  // segment 1 ~ 6 : hip yaw, hip roll, hip pitch, knee, ankle pitch, ankle roll
+  KDL::Vector hip_pitch_position = leg_chain.getSegment(2).getFrameToTip().p;
+  KDL::Vector thigh = leg_chain.getSegment(3).getFrameToTip().p;
+  KDL::Vector calf = leg_chain.getSegment(4).getFrameToTip().p;
+  KDL::Vector ankle = leg_chain.getSegment(6).getFrameToTip().p;
+
+  robotis_op::LegIKParameter leg_param;
+  leg_param.hip_pitch_offset_m = hip_pitch_position.x();
+  leg_param.hip_offset_angle_rad = atan2(thigh.x(), -thigh.z());
+  leg_param.thigh_length_m = sqrt(thigh.x()*thigh.x() + thigh.z()*thigh.z());
+  leg_param.calf_length_m = fabs(calf.z());
+  leg_param.ankle_length_m = fabs(ankle.z());
+
+  for (int i=0; i<LEG_JOINT_NUM; i++)
+  {
+    // unit axes only, so the sum of the components is the direction
+    KDL::Vector axis = leg_chain.getSegment(i+1).getJoint().JointAxis();
+    leg_param.joint_direction[i] = axis.x() + axis.y() + axis.z();
+
+    robotis_op::LinkData *link = op3_kd_->op3_link_data_[leg_start_id + 2 * i];
+    leg_param.joint_limit_min[i] = link->joint_limit_min_;
+    leg_param.joint_limit_max[i] = link->joint_limit_max_;
+  }
+
+  return leg_param;
+}
+
+bool OP3Kinematics::checkAnalyticInverseKinematics()
+{
+  // hip yaw, hip roll, hip pitch, knee, ankle pitch, ankle roll about the positive axes (knee bent is positive)
+  const double sample[4][LEG_JOINT_NUM] =
+  {
+    { 0.0,   0.0,  -0.3, 0.6, -0.3,  0.0 },
+    { 0.1,  -0.05, -0.5, 1.0, -0.4,  0.05 },
+    { -0.2,  0.1,  -0.2, 0.9, -0.6, -0.1 },
+    { 0.3,   0.0,  -0.7, 1.2, -0.5,  0.0 }
+  };
+
+  for (int leg=0; leg<2; leg++)
+  {
+    KDL::ChainFkSolverPos_recursive *fk_solver = (leg == 0 ? rleg_fk_solver_ : lleg_fk_solver_);
+    const robotis_op::LegIKParameter &leg_param = (leg == 0 ? rleg_ik_param_ : lleg_ik_param_);
+    const KDL::Vector &hip_position = (leg == 0 ? rleg_hip_position_ : lleg_hip_position_);
+
+    for (int ix=0; ix<4; ix++)
+    {
+      KDL::JntArray joint_position(LEG_JOINT_NUM);
+      for (int i=0; i<LEG_JOINT_NUM; i++)
+        joint_position(i) = sample[ix][i]*leg_param.joint_direction[i];
+
+      KDL::Frame pose, solved_pose;
+      fk_solver->JntToCart(joint_position, pose);
+
+      double output[LEG_JOINT_NUM];
+      if (solveAnalyticLegInverseKinematics(leg_param, hip_position, pose, output) == false)
+        return false;
+
+      KDL::JntArray solved_joint_position(LEG_JOINT_NUM);
+      for (int i=0; i<LEG_JOINT_NUM; i++)
+        solved_joint_position(i) = output[i];
+
+      fk_solver->JntToCart(solved_joint_position, solved_pose);
+
+      KDL::Twist diff = KDL::diff(pose, solved_pose);
+      if (diff.vel.Norm() > 1e-6 || diff.rot.Norm() > 1e-6)
+        return false;
+    }
+  }
+
+  return true;
+}
+
+void OP3Kinematics::setInverseKinematicsSolver(IK_SOLVER_TYPE ik_solver_type)
+{
+  if (ik_solver_type == ANALYTIC_SOLVER && analytic_ik_valid_ == false)
+  {
+    ROS_WARN("closed-form leg IK does not match the KDL chain, use KDL solver");
+    return;
+  }
+
+  ik_solver_type_ = ik_solver_type;
+}
+
+void OP3Kinematics::setPelvisPose(Eigen::MatrixXd pelvis_position, Eigen::MatrixXd pelvis_orientation)
+{
+  pelvis_frame_.p = KDL::Vector(pelvis_position.coeff(0,0), pelvis_position.coeff(1,0), pelvis_position.coeff(2,0));
+  pelvis_frame_.M = KDL::Rotation(pelvis_orientation.coeff(0,0), pelvis_orientation.coeff(0,1), pelvis_orientation.coeff(0,2),
+                                  pelvis_orientation.coeff(1,0), pelvis_orientation.coeff(1,1), pelvis_orientation.coeff(1,2),
+                                  pelvis_orientation.coeff(2,0), pelvis_orientation.coeff(2,1), pelvis_orientation.coeff(2,2));
 }
 
 void OP3Kinematics::setJointPosition(Eigen::VectorXd rleg_joint_position, Eigen::VectorXd lleg_joint_position)
@@ -289,6 +380,7 @@ void OP3Kinematics::solveForwardKinematics(std::vector<double_t> &rleg_position,
 
   KDL::Frame rleg_pose;
   rleg_fk_solver_->JntToCart(rleg_joint_position, rleg_pose);
+  rleg_pose = pelvis_frame_ * rleg_pose;
 
   rleg_pose_.position.x = rleg_pose.p.x();
   rleg_pose_.position.y = rleg_pose.p.y();
@@ -318,6 +410,7 @@ void OP3Kinematics::solveForwardKinematics(std::vector<double_t> &rleg_position,
 
   KDL::Frame lleg_pose;
   lleg_fk_solver_->JntToCart(lleg_joint_position, lleg_pose);
+  lleg_pose = pelvis_frame_ * lleg_pose;
 
   lleg_pose_.position.x = lleg_pose.p.x();
   lleg_pose_.position.y = lleg_pose.p.y();
@@ -350,10 +443,6 @@ bool OP3Kinematics::solveInverseKinematics(std::vector<double_t> &rleg_output,
   //  ROS_INFO("right x: %f, y: %f, z: %f", rleg_target_position(0), rleg_target_position(1), rleg_target_position(2));
   //  ROS_INFO("left x: %f, y: %f, z: %f", lleg_target_position(0), lleg_target_position(1), lleg_target_position(2));
 
-  // rleg
-  KDL::JntArray rleg_joint_position;
-  rleg_joint_position.data = rleg_joint_position_;
-
   KDL::Frame rleg_desired_pose;
   rleg_desired_pose.p.x(rleg_target_position.coeff(0,0));
   rleg_desired_pose.p.y(rleg_target_position.coeff(1,0));
@@ -364,6 +453,34 @@ bool OP3Kinematics::solveInverseKinematics(std::vector<double_t> &rleg_output,
                                                   rleg_target_orientation.z(),
                                                   rleg_target_orientation.w());
 
+  rleg_desired_pose = pelvis_frame_.Inverse() * rleg_desired_pose;
+
+  KDL::Frame lleg_desired_pose;
+  lleg_desired_pose.p.x(lleg_target_position.coeff(0,0));
+  lleg_desired_pose.p.y(lleg_target_position.coeff(1,0));
+  lleg_desired_pose.p.z(lleg_target_position.coeff(2,0));
+
+  lleg_desired_pose.M = KDL::Rotation::Quaternion(lleg_target_orientation.x(),
+                                                  lleg_target_orientation.y(),
+                                                  lleg_target_orientation.z(),
+                                                  lleg_target_orientation.w());
+
+  lleg_desired_pose = pelvis_frame_.Inverse() * lleg_desired_pose;
+
+  // the closed-form solution is exact on the kdl chain, so a rejected pose is unreachable within the joint limits
+  if (ik_solver_type_ == ANALYTIC_SOLVER)
+  {
+    if (solveAnalyticInverseKinematics(rleg_output, rleg_desired_pose, lleg_output, lleg_desired_pose) == true)
+      return true;
+
+    ROS_WARN("LEG IK ERR : out of reach or joint limit");
+    return false;
+  }
+
+  // rleg
+  KDL::JntArray rleg_joint_position;
+  rleg_joint_position.data = rleg_joint_position_;
+
   KDL::JntArray rleg_desired_joint_position;
   rleg_desired_joint_position.resize(LEG_JOINT_NUM);
 
@@ -379,16 +496,6 @@ bool OP3Kinematics::solveInverseKinematics(std::vector<double_t> &rleg_output,
   KDL::JntArray lleg_joint_position;
   lleg_joint_position.data = lleg_joint_position_;
 
-  KDL::Frame lleg_desired_pose;
-  lleg_desired_pose.p.x(lleg_target_position.coeff(0,0));
-  lleg_desired_pose.p.y(lleg_target_position.coeff(1,0));
-  lleg_desired_pose.p.z(lleg_target_position.coeff(2,0));
-
-  lleg_desired_pose.M = KDL::Rotation::Quaternion(lleg_target_orientation.x(),
-                                                  lleg_target_orientation.y(),
-                                                  lleg_target_orientation.z(),
-                                                  lleg_target_orientation.w());
-
   KDL::JntArray lleg_desired_joint_position;
   lleg_desired_joint_position.resize(LEG_JOINT_NUM);
 
@@ -413,6 +520,75 @@ bool OP3Kinematics::solveInverseKinematics(std::vector<double_t> &rleg_output,
   return true;
 }
 
+bool OP3Kinematics::solveAnalyticInverseKinematics(std::vector<double_t> &rleg_output,
+                                                   Eigen::MatrixXd rleg_target_position, Eigen::Quaterniond rleg_target_orientation,
+                                                   std::vector<double_t> &lleg_output,
+                                                   Eigen::MatrixXd lleg_target_position, Eigen::Quaterniond lleg_target_orientation)
+{
+  KDL::Frame rleg_desired_pose(KDL::Rotation::Quaternion(rleg_target_orientation.x(), rleg_target_orientation.y(),
+                                                         rleg_target_orientation.z(), rleg_target_orientation.w()),
+                               KDL::Vector(rleg_target_position.coeff(0,0), rleg_target_position.coeff(1,0),
+                                           rleg_target_position.coeff(2,0)));
+
+  KDL::Frame lleg_desired_pose(KDL::Rotation::Quaternion(lleg_target_orientation.x(), lleg_target_orientation.y(),
+                                                         lleg_target_orientation.z(), lleg_target_orientation.w()),
+                               KDL::Vector(lleg_target_position.coeff(0,0), lleg_target_position.coeff(1,0),
+                                           lleg_target_position.coeff(2,0)));
+
+  return solveAnalyticInverseKinematics(rleg_output, rleg_desired_pose, lleg_output, lleg_desired_pose);
+}
+
+bool OP3Kinematics::solveAnalyticInverseKinematics(std::vector<double_t> &rleg_output, const KDL::Frame &rleg_desired_pose,
+                                                   std::vector<double_t> &lleg_output, const KDL::Frame &lleg_desired_pose)
+{
+  double rleg_angle[LEG_JOINT_NUM], lleg_angle[LEG_JOINT_NUM];
+
+  if (solveAnalyticLegInverseKinematics(rleg_ik_param_, rleg_hip_position_, rleg_desired_pose, rleg_angle) == false)
+    return false;
+
+  if (solveAnalyticLegInverseKinematics(lleg_ik_param_, lleg_hip_position_, lleg_desired_pose, lleg_angle) == false)
+    return false;
+
+  // output
+  rleg_output.resize(LEG_JOINT_NUM);
+  lleg_output.resize(LEG_JOINT_NUM);
+
+  for (int i=0; i<LEG_JOINT_NUM; i++)
+  {
+    rleg_output[i] = rleg_angle[i];
+    lleg_output[i] = lleg_angle[i];
+  }
+
+  return true;
+}
+
+bool OP3Kinematics::solveAnalyticLegInverseKinematics(const robotis_op::LegIKParameter &leg_param,
+                                                      const KDL::Vector &hip_position,
+                                                      const KDL::Frame &desired_pose, double *output)
+{
+  KDL::Vector position = desired_pose.p - hip_position;
+  double x = position.x(), y = position.y(), z = position.z();
+  double roll, pitch, yaw;
+  desired_pose.M.GetRPY(roll, pitch, yaw);
+
+  robotis_op::LegPoseArray pose;
+  pose.x = &x;
+  pose.y = &y;
+  pose.z = &z;
+  pose.roll = &roll;
+  pose.pitch = &pitch;
+  pose.yaw = &yaw;
+
+  robotis_op::LegJointArray joint;
+  unsigned char valid = 0;
+  for (int i=0; i<LEG_JOINT_NUM; i++)
+    joint.joint[i] = output + i;
+  joint.valid = &valid;
+
+  // unreachable targets come out as nan and fail the joint limit check
+  return (robotis_op::calcLegInverseKinematicsBatch(leg_param, pose, joint, 1) == 1);
+}
+
 void OP3Kinematics::finalize()
 {
   //  delete rleg_chain_;
@@ -421,6 +597,10 @@ void OP3Kinematics::finalize()
   delete rleg_fk_solver_;
   delete rleg_ik_vel_solver_;
   delete rleg_ik_pos_solver_;
+  rleg_fk_solver_ = NULL;
+  rleg_ik_vel_solver_ = NULL;
+  rleg_ik_pos_solver_ = NULL;
+  rleg_chain_ = KDL::Chain();
 
   //  delete lleg_chain_;
   //  delete lleg_dyn_param_;
@@ -428,4 +608,8 @@ void OP3Kinematics::finalize()
   delete lleg_fk_solver_;
   delete lleg_ik_vel_solver_;
   delete lleg_ik_pos_solver_;
+  lleg_fk_solver_ = NULL;
+  lleg_ik_vel_solver_ = NULL;
+  lleg_ik_pos_solver_ = NULL;
+  lleg_chain_ = KDL::Chain();
 }
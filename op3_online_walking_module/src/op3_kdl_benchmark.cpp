@@ -0,0 +1,107 @@
+/*******************************************************************************
+* Copyright 2017 ROBOTIS CO., LTD.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+/* Author: SCH */
+
+// per-tick cost of OP3Kinematics as the walking module uses it (pelvis pose, joint state, FK, IK).
+// "rebuild" tears the leg chains and solvers down and builds them again every tick, as before they were kept
+// usage : op3_kdl_benchmark [tick count]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "op3_online_walking_module/op3_kdl.h"
+
+enum BenchmarkMode
+{
+  REBUILD_KDL,
+  CACHED_KDL,
+  CACHED_ANALYTIC
+};
+
+double runTicks(OP3Kinematics &kinematics, BenchmarkMode mode, int tick_count, int &ik_fail_count)
+{
+  kinematics.setInverseKinematicsSolver(mode == CACHED_ANALYTIC ? ANALYTIC_SOLVER : KDL_SOLVER);
+
+  Eigen::VectorXd rleg_joint_position(LEG_JOINT_NUM), lleg_joint_position(LEG_JOINT_NUM);
+  rleg_joint_position << 0.0, 0.0, 0.3, -0.6, -0.3, 0.0;
+  lleg_joint_position << 0.0, 0.0, -0.3, 0.6, 0.3, 0.0;
+
+  Eigen::MatrixXd pelvis_position = Eigen::MatrixXd::Zero(3,1);
+  Eigen::MatrixXd pelvis_orientation = Eigen::MatrixXd::Identity(3,3);
+
+  std::vector<double_t> rleg_position, rleg_orientation, lleg_position, lleg_orientation;
+  std::vector<double_t> rleg_output, lleg_output;
+
+  ik_fail_count = 0;
+
+  ros::WallTime start = ros::WallTime::now();
+
+  for (int tick=0; tick<tick_count; tick++)
+  {
+    if (mode == REBUILD_KDL)
+    {
+      kinematics.finalize();
+      kinematics.initialize();
+    }
+
+    pelvis_position.coeffRef(0,0) = 0.01*sin(0.01*tick);
+
+    kinematics.setPelvisPose(pelvis_position, pelvis_orientation);
+    kinematics.setJointPosition(rleg_joint_position, lleg_joint_position);
+    kinematics.solveForwardKinematics(rleg_position, rleg_orientation, lleg_position, lleg_orientation);
+
+    Eigen::MatrixXd rleg_target_position(3,1), lleg_target_position(3,1);
+    rleg_target_position << rleg_position[0] + 0.005, rleg_position[1], rleg_position[2];
+    lleg_target_position << lleg_position[0] - 0.005, lleg_position[1], lleg_position[2];
+
+    Eigen::Quaterniond rleg_target_orientation(rleg_orientation[3], rleg_orientation[0], rleg_orientation[1], rleg_orientation[2]);
+    Eigen::Quaterniond lleg_target_orientation(lleg_orientation[3], lleg_orientation[0], lleg_orientation[1], lleg_orientation[2]);
+
+    if (kinematics.solveInverseKinematics(rleg_output, rleg_target_position, rleg_target_orientation,
+                                          lleg_output, lleg_target_position, lleg_target_orientation) == false)
+      ik_fail_count++;
+  }
+
+  return (ros::WallTime::now() - start).toSec() / tick_count * 1e6;
+}
+
+int main(int argc, char **argv)
+{
+  int tick_count = 10000;
+  if (argc > 1)
+    tick_count = atoi(argv[1]);
+
+  if (tick_count <= 0)
+  {
+    printf("usage : %s [tick count]\n", argv[0]);
+    return 1;
+  }
+
+  OP3Kinematics kinematics;
+
+  const char *mode_name[3] = { "rebuild, KDL solver", "cached, KDL solver", "cached, analytic solver" };
+  BenchmarkMode mode[3] = { REBUILD_KDL, CACHED_KDL, CACHED_ANALYTIC };
+
+  for (int i=0; i<3; i++)
+  {
+    int ik_fail_count;
+    double tick_time = runTicks(kinematics, mode[i], tick_count, ik_fail_count);
+
+    printf("%-24s : %8.2f us per tick (%d ticks, %d IK failures)\n", mode_name[i], tick_time, tick_count, ik_fail_count);
+  }
+
+  return 0;
+}
@@ -0,0 +1,279 @@
+/*******************************************************************************
+* Copyright 2017 ROBOTIS CO., LTD.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+/* Author: SCH */
+
+#include <stdio.h>
+#include <algorithm>
+#include "op3_online_walking_module/preview_matrix.h"
+
+#define PREVIEW_MATRIX_CACHE_MAGIC    (0x4D56504F)  // "OPVM"
+#define PREVIEW_MATRIX_CACHE_VERSION  (2)
+#define RICCATI_MAX_ITER              (100)
+#define RICCATI_TOLERANCE             (1e-12)
+
+PreviewMatrix::PreviewMatrix()
+  : q_e_(1.0),
+    q_x_(0.0),
+    r_(1e-6),
+    cache_loaded_(false)
+{
+
+}
+
+PreviewMatrix::~PreviewMatrix()
+{
+
+}
+
+void PreviewMatrix::setWeight(double q_e, double q_x, double r)
+{
+  q_e_ = q_e;
+  q_x_ = q_x;
+  r_ = r;
+}
+
+void PreviewMatrix::setCacheFile(const std::string &path)
+{
+  cache_path_ = path;
+  cache_loaded_ = false;
+}
+
+bool PreviewMatrix::calcPreviewMatrix(double lipm_height, double control_cycle,
+                                      std::vector<double_t> &K, std::vector<double_t> &P)
+{
+  if (cache_loaded_ == false)
+  {
+    loadCacheFile();
+    cache_loaded_ = true;
+  }
+
+  PreviewMatrixData data;
+
+  if (findCache(lipm_height, control_cycle, data) == false)
+  {
+    if (solveRiccatiEquation(lipm_height, control_cycle, data) == false)
+      return false;
+
+    cache_.push_back(data);
+    saveCacheFile();
+  }
+
+  K.assign(data.K, data.K + 4);
+  P.assign(data.P, data.P + 16);
+
+  return true;
+}
+
+void PreviewMatrix::getDefaultPreviewMatrix(std::vector<double_t> &K, std::vector<double_t> &P)
+{
+  static const double default_K[4] =
+  {
+    739.200064, 24489.822984, 3340.410380, 69.798325
+  };
+
+  static const double default_P[16] =
+  {
+    33.130169, 531.738962, 60.201291, 0.327533,
+    531.738962, 10092.440286, 1108.851055, 7.388990,
+    60.201291, 1108.851055, 130.194694, 0.922502,
+    0.327533, 7.388990, 0.922502, 0.012336
+  };
+
+  K.assign(default_K, default_K + 4);
+  P.assign(default_P, default_P + 16);
+}
+
+bool PreviewMatrix::checkDefaultPreviewMatrix(double tolerance)
+{
+  PreviewMatrix solver;
+  PreviewMatrixData data;
+
+  if (solver.solveRiccatiEquation(0.12, 0.008, data) == false)
+    return false;
+
+  std::vector<double_t> K, P;
+  getDefaultPreviewMatrix(K, P);
+
+  for (int i=0; i<4; i++)
+  {
+    if (fabs(data.K[i] - K[i]) > tolerance*std::max(1.0, fabs(K[i])))
+      return false;
+  }
+
+  for (int i=0; i<16; i++)
+  {
+    if (fabs(data.P[i] - P[i]) > tolerance*std::max(1.0, fabs(P[i])))
+      return false;
+  }
+
+  return true;
+}
+
+bool PreviewMatrix::solveRiccatiEquation(double lipm_height, double control_cycle, PreviewMatrixData &data)
+{
+  double t = control_cycle;
+
+  Eigen::Matrix3d A;
+  A << 1,  t,  t*t/2.0,
+       0,  1,  t,
+       0,  0,  1;
+
+  Eigen::Vector3d b;
+  b << t*t*t/6.0,
+       t*t/2.0,
+       t;
+
+  Eigen::RowVector3d c;
+  c << 1, 0, -lipm_height/9.81;
+
+  // augmented system with integral of zmp error
+  Eigen::Matrix4d A_aug = Eigen::Matrix4d::Zero();
+  A_aug.coeffRef(0,0) = 1;
+  A_aug.block<1,3>(0,1) = c*A;
+  A_aug.block<3,3>(1,1) = A;
+
+  Eigen::Vector4d b_aug;
+  b_aug.coeffRef(0) = c.dot(b);
+  b_aug.tail<3>() = b;
+
+  // same weighting as calcPreviewParam : Q_e on the zmp error integral, com and com vel, Q_x on com accel
+  Eigen::Matrix4d Q = Eigen::Matrix4d::Zero();
+  Q.coeffRef(0,0) = q_e_;
+  Q.coeffRef(1,1) = q_e_;
+  Q.coeffRef(2,2) = q_e_;
+  Q.coeffRef(3,3) = q_x_;
+
+  // structure-preserving doubling algorithm (quadratic convergence)
+  Eigen::Matrix4d A_k = A_aug;
+  Eigen::Matrix4d G_k = b_aug * b_aug.transpose() / r_;
+  Eigen::Matrix4d H_k = Q;
+  Eigen::Matrix4d I = Eigen::Matrix4d::Identity();
+
+  bool converged = false;
+
+  for (int iter = 0; iter < RICCATI_MAX_ITER; iter++)
+  {
+    Eigen::PartialPivLU<Eigen::Matrix4d> W(I + G_k*H_k);
+
+    Eigen::Matrix4d W_inv_A = W.solve(A_k);
+    Eigen::Matrix4d W_inv_G = W.solve(G_k);
+
+    Eigen::Matrix4d H_next = H_k + A_k.transpose()*H_k*W_inv_A;
+    G_k = G_k + A_k*W_inv_G*A_k.transpose();
+    A_k = A_k*W_inv_A;
+
+    double diff = (H_next - H_k).norm();
+    H_k = H_next;
+
+    if (diff <= RICCATI_TOLERANCE * H_k.norm())
+    {
+      converged = true;
+      break;
+    }
+  }
+
+  if (converged == false || H_k.allFinite() == false)
+    return false;
+
+  Eigen::Matrix4d P = 0.5*(H_k + H_k.transpose());
+  Eigen::RowVector4d K = (b_aug.transpose()*P*A_aug) / (r_ + b_aug.dot(P*b_aug));
+
+  data.lipm_height = lipm_height;
+  data.control_cycle = control_cycle;
+  data.q_e = q_e_;
+  data.q_x = q_x_;
+  data.r = r_;
+
+  for (int i=0; i<4; i++)
+    data.K[i] = K.coeff(i);
+
+  for (int col=0; col<4; col++)
+  {
+    for (int row=0; row<4; row++)
+      data.P[col*4+row] = P.coeff(row,col);
+  }
+
+  return true;
+}
+
+bool PreviewMatrix::findCache(double lipm_height, double control_cycle, PreviewMatrixData &data)
+{
+  for (size_t i=0; i<cache_.size(); i++)
+  {
+    if (cache_[i].lipm_height == lipm_height && cache_[i].control_cycle == control_cycle &&
+        cache_[i].q_e == q_e_ && cache_[i].q_x == q_x_ && cache_[i].r == r_)
+    {
+      data = cache_[i];
+      return true;
+    }
+  }
+
+  return false;
+}
+
+bool PreviewMatrix::loadCacheFile()
+{
+  if (cache_path_.empty())
+    return false;
+
+  FILE* cache_file = fopen(cache_path_.c_str(), "rb");
+  if (cache_file == 0)
+    return false;
+
+  uint32_t header[3];
+  if (fread(header, sizeof(uint32_t), 3, cache_file) != 3 ||
+      header[0] != PREVIEW_MATRIX_CACHE_MAGIC || header[1] != PREVIEW_MATRIX_CACHE_VERSION)
+  {
+    fclose(cache_file);
+    return false;
+  }
+
+  std::vector<PreviewMatrixData> cache(header[2]);
+  if (header[2] > 0 && fread(&cache[0], sizeof(PreviewMatrixData), header[2], cache_file) != header[2])
+  {
+    fclose(cache_file);
+    return false;
+  }
+
+  fclose(cache_file);
+
+  cache_ = cache;
+  return true;
+}
+
+bool PreviewMatrix::saveCacheFile()
+{
+  if (cache_path_.empty())
+    return false;
+
+  FILE* cache_file = fopen(cache_path_.c_str(), "wb");
+  if (cache_file == 0)
+    return false;
+
+  uint32_t header[3];
+  header[0] = PREVIEW_MATRIX_CACHE_MAGIC;
+  header[1] = PREVIEW_MATRIX_CACHE_VERSION;
+  header[2] = cache_.size();
+
+  fwrite(header, sizeof(uint32_t), 3, cache_file);
+  if (cache_.size() > 0)
+    fwrite(&cache_[0], sizeof(PreviewMatrixData), cache_.size(), cache_file);
+
+  fclose(cache_file);
+
+  return true;
+}
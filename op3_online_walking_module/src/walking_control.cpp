@@ -22,8 +22,10 @@
 WalkingControl::WalkingControl(double control_cycle,
                                double dsp_ratio, double lipm_height, double foot_height_max, double zmp_offset_x, double zmp_offset_y,
                                std::vector<double_t> x_lipm, std::vector<double_t> y_lipm,
-                               double foot_distance)
-  : walking_leg_(LEG_COUNT),
+                               double foot_distance,
+                               robotis_op::OP3KinematicsDynamics *op3_kd)
+  : op3_kd_(op3_kd),
+    walking_leg_(LEG_COUNT),
     walking_phase_(PHASE_COUNT)
 {
   control_cycle_ = control_cycle;
@@ -100,6 +102,12 @@ WalkingControl::WalkingControl(double control_cycle,
   preview_sum_zmp_x_ = 0.0;
   preview_sum_zmp_y_ = 0.0;
 
+  preview_ref_zmp_x_ = Eigen::VectorXd::Zero(2*preview_size_);
+  preview_ref_zmp_y_ = Eigen::VectorXd::Zero(2*preview_size_);
+  preview_ref_zmp_head_ = 0;
+  preview_ref_zmp_index_ = 0;
+  preview_ref_zmp_update_ = true;
+
 //  ROS_INFO("x_lipm: %f", x_lipm[0]);
 //  ROS_INFO("y_lipm: %f", y_lipm[0]);
 }
@@ -147,6 +155,9 @@ void WalkingControl::initialize(op3_online_walking_module_msgs::FootStepCommand
   sum_of_cx_ = 0.0;
   sum_of_cy_ = 0.0;
 
+  // foot step plan is changed
+  preview_ref_zmp_update_ = true;
+
   u_x_.resize(1,1);
   u_y_.resize(1,1);
   u_x_.fill(0.0);
@@ -191,6 +202,9 @@ void WalkingControl::initialize(op3_online_walking_module_msgs::Step2DArray foot
   sum_of_cx_ = 0.0;
   sum_of_cy_ = 0.0;
 
+  // foot step plan is changed
+  preview_ref_zmp_update_ = true;
+
   u_x_.resize(1,1);
   u_y_.resize(1,1);
   u_x_.fill(0.0);
@@ -773,41 +787,65 @@ void WalkingControl::calcPreviewParam(std::vector<double_t> K, int K_row, int K_
   k_x_.resize(1,3);
   k_x_ << K_.coeff(0,1), K_.coeff(0,2), K_.coeff(0,3);
 
-  preview_control_ = new robotis_framework::PreviewControl();
+  // 1 x N gain, column-major so its entries are already contiguous
+  Eigen::MatrixXd f = op3_kd_->calcPreviewParam(preview_time_, control_cycle_,
+                                                lipm_height_,
+                                                K_, P_);
+  f_ = Eigen::Map<const Eigen::VectorXd>(f.data(), f.size());
 
-  f_ = preview_control_->calcPreviewParam(preview_time_, control_cycle_,
-                                          lipm_height_,
-                                          K_, P_);
-
-  delete preview_control_;
+  preview_ref_zmp_update_ = true;
 }
 
-void WalkingControl::calcPreviewControl(double time, int step)
+void WalkingControl::updatePreviewRefZMP(int preview_index)
 {
-  int index_new;
-
-  preview_sum_zmp_x_ = 0.0;
-  preview_sum_zmp_y_ = 0.0;
+  int fin_index = round(fin_time_/control_cycle_) + 1;
+  int shift = preview_index - preview_ref_zmp_index_;
 
-  for (int i=0; i<preview_size_; i++)
+  if (preview_ref_zmp_update_ == true || shift < 0 || shift >= preview_size_)
   {
-    index_new = time/control_cycle_ + (i+1) - 1;
-    if (index_new < 0)
-      index_new = 0;
+    // rebuild whole horizon
+    preview_ref_zmp_head_ = 0;
 
-    int fin_index = round(fin_time_/control_cycle_) +1;
-    int step_new = step + index_new/fin_index;
+    for (int i=0; i<preview_size_; i++)
+    {
+      int step = (preview_index + i) / fin_index;
 
-    double ref_zmp_x = calcRefZMPx(step_new);
-    double ref_zmp_y = calcRefZMPy(step_new);
+      preview_ref_zmp_x_.coeffRef(i) = preview_ref_zmp_x_.coeffRef(i+preview_size_) = calcRefZMPx(step);
+      preview_ref_zmp_y_.coeffRef(i) = preview_ref_zmp_y_.coeffRef(i+preview_size_) = calcRefZMPy(step);
+    }
 
-    double preview_zmp_x = f_.coeff(0,i)*ref_zmp_x;
-    double preview_zmp_y = f_.coeff(0,i)*ref_zmp_y;
+    preview_ref_zmp_update_ = false;
+  }
+  else
+  {
+    // drop head and append new tail
+    for (int i=0; i<shift; i++)
+    {
+      int tail = preview_ref_zmp_head_;
+      int step = (preview_ref_zmp_index_ + i + preview_size_) / fin_index;
+
+      preview_ref_zmp_x_.coeffRef(tail) = preview_ref_zmp_x_.coeffRef(tail+preview_size_) = calcRefZMPx(step);
+      preview_ref_zmp_y_.coeffRef(tail) = preview_ref_zmp_y_.coeffRef(tail+preview_size_) = calcRefZMPy(step);
 
-    preview_sum_zmp_x_ += preview_zmp_x;
-    preview_sum_zmp_y_ += preview_zmp_y;
+      preview_ref_zmp_head_ = (preview_ref_zmp_head_ + 1) % preview_size_;
+    }
   }
 
+  preview_ref_zmp_index_ = preview_index;
+}
+
+void WalkingControl::calcPreviewControl(double time, int step)
+{
+  int index = time/control_cycle_;
+  if (index < 0)
+    index = 0;
+
+  int fin_index = round(fin_time_/control_cycle_) + 1;
+  updatePreviewRefZMP(step*fin_index + index);
+
+  preview_sum_zmp_x_ = f_.dot(preview_ref_zmp_x_.segment(preview_ref_zmp_head_, preview_size_));
+  preview_sum_zmp_y_ = f_.dot(preview_ref_zmp_y_.segment(preview_ref_zmp_head_, preview_size_));
+
   u_x_(0,0) =
       -k_s_*(sum_of_cx_ - sum_of_zmp_x_)
       -(k_x_(0,0)*x_lipm_(0,0) + k_x_(0,1)*x_lipm_(1,0) + k_x_(0,2)*x_lipm_(2,0))